@@ -0,0 +1,250 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "aggregation.h"
+
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "statistics.h"
+#include "radixsort.h"
+
+/*!
+ * \brief name of statistic for series names
+ * \return
+ */
+QString AggregationSpec::name() const
+{
+    switch(type){
+    case AGG_MEAN: return "mean";
+    case AGG_MEDIAN: return "median";
+    case AGG_MIN: return "min";
+    case AGG_MAX: return "max";
+    case AGG_STD: return "std";
+    case AGG_COUNT: return "count";
+    case AGG_SUM: return "sum";
+    case AGG_PERCENTILE: return QString("p%1").arg(percentile);
+    default: break;
+    }
+    return QString();
+}
+/*!
+ * \brief median/percentiles need all values, the others only running statistics
+ * \return
+ */
+bool AggregationSpec::needsValues() const
+{
+    return type==AGG_MEDIAN || type==AGG_PERCENTILE;
+}
+/*!
+ * \brief statistic from running statistics
+ * \param stats
+ * \return NaN for median/percentiles
+ */
+double AggregationSpec::valueOf(const RunningStats &stats) const
+{
+    switch(type){
+    case AGG_MEAN: return stats.mean;
+    case AGG_MIN: return stats.min;
+    case AGG_MAX: return stats.max;
+    case AGG_STD: return stats.std();
+    case AGG_COUNT: return double(stats.count);
+    case AGG_SUM: return stats.sum();
+    default: break;
+    }
+    return std::nan("");
+}
+/*!
+ * \brief name of envelope for series names
+ * \return
+ */
+QString EnvelopeSpec::name() const
+{
+    switch(type){
+    case ENV_MINMAX: return "min/max";
+    case ENV_SIGMA: return QString("mean+-%1sigma").arg(sigmas);
+    default: break;
+    }
+    return QString();
+}
+/*!
+ * \brief points (x,y) of rows, optionally aggregated per x
+ * Rows need not be sorted by x. One pass accumulates y per distinct x in a hash table
+ * (Welford accumulators, values are only kept for median/percentiles).
+ * Aggregated points are sorted by x. Rows with NaN in x or y are skipped.
+ * \param x x values, nullptr uses running number
+ * \param y y values
+ * \param rows
+ * \param spec
+ * \param sortX sort points which are not aggregated by x (stable), otherwise they keep the row order
+ * \return
+ */
+QList<QPointF> aggregateRows(const double *x, const double *y, const RowSelection &rows, const AggregationSpec &spec, bool sortX)
+{
+    QList<QPointF> result;
+    qreal cnt=0;
+    if(spec.type==AggregationSpec::AGG_NONE && sortX && x){
+        // sort row ids, points are created once in final order
+        std::vector<int> ids;
+        rows.forEach([&](qsizetype i){
+            if(!std::isnan(x[i]) && !std::isnan(y[i])){
+                ids.push_back(int(i));
+            }
+        });
+        sortRowsByValue(ids,x);
+        result.reserve(int(ids.size()));
+        for(int i:ids){
+            result.append(QPointF(x[i],y[i]));
+        }
+        return result;
+    }
+    if(spec.type==AggregationSpec::AGG_NONE){
+        rows.forEach([&](qsizetype i){
+            qreal xv;
+            if(x){
+                xv=x[i];
+            }else{
+                xv=cnt;
+                cnt+=1;
+            }
+            if(!std::isnan(xv) && !std::isnan(y[i])){
+                result.append(QPointF(xv,y[i]));
+            }
+        });
+        return result;
+    }
+    const bool keepValues=spec.needsValues();
+    QHash<double,int> slots;
+    std::vector<double> xs;
+    std::vector<RunningStats> stats;
+    std::vector<std::vector<double>> values;
+    rows.forEach([&](qsizetype i){
+        qreal xv;
+        if(x){
+            xv=x[i];
+        }else{
+            xv=cnt;
+            cnt+=1;
+        }
+        const double yv=y[i];
+        if(std::isnan(xv) || std::isnan(yv)) return;
+        int slot;
+        auto it=slots.constFind(xv);
+        if(it==slots.constEnd()){
+            slot=int(xs.size());
+            slots.insert(xv,slot);
+            xs.push_back(xv);
+            stats.emplace_back();
+            if(keepValues){
+                values.emplace_back();
+            }
+        }else{
+            slot=it.value();
+        }
+        stats[slot].add(yv);
+        if(keepValues){
+            values[slot].push_back(yv);
+        }
+    });
+
+    std::vector<int> order(xs.size());
+    for(std::size_t i=0;i<order.size();++i){
+        order[i]=int(i);
+    }
+    std::sort(order.begin(),order.end(),[&xs](int a,int b){
+        return xs[a]<xs[b];
+    });
+    result.reserve(int(order.size()));
+    for(int slot:order){
+        double value;
+        if(keepValues){
+            value=percentileOf(values[slot],spec.type==AggregationSpec::AGG_MEDIAN ? 50 : spec.percentile);
+        }else{
+            value=spec.valueOf(stats[slot]);
+        }
+        result.append(QPointF(xs[slot],value));
+    }
+    return result;
+}
+/*!
+ * \brief percentile with linear interpolation between closest ranks
+ * Values are partially reordered (nth_element), no full sort.
+ * \param values not empty
+ * \param percentile 0..100
+ * \return
+ */
+double percentileOf(std::vector<double> &values, double percentile)
+{
+    if(values.empty()) return std::nan("");
+    const double pos=qBound(0.,percentile,100.)/100*(values.size()-1);
+    const std::size_t lower=std::size_t(pos);
+    std::nth_element(values.begin(),values.begin()+lower,values.end());
+    const double lowerValue=values[lower];
+    if(lower+1>=values.size()) return lowerValue;
+    const double upperValue=*std::min_element(values.begin()+lower+1,values.end());
+    return lowerValue+(pos-lower)*(upperValue-lowerValue);
+}
+/*!
+ * \brief envelope of series [first,last) per x value
+ * Series are aligned on x by a hash join, so they need neither be sorted nor share all x values.
+ * All y values of all series at one x form the sample of the envelope.
+ * \param series
+ * \param first
+ * \param last
+ * \param spec
+ * \return envelope sorted by x
+ */
+std::vector<EnvelopePoint> envelopeOf(const std::vector<QList<QPointF>> &series, std::size_t first, std::size_t last, const EnvelopeSpec &spec)
+{
+    QHash<double,int> slots;
+    std::vector<double> xs;
+    std::vector<RunningStats> stats;
+    for(std::size_t i=first;i<last;++i){
+        for(const QPointF &p:series[i]){
+            int slot;
+            auto it=slots.constFind(p.x());
+            if(it==slots.constEnd()){
+                slot=int(xs.size());
+                slots.insert(p.x(),slot);
+                xs.push_back(p.x());
+                stats.emplace_back();
+            }else{
+                slot=it.value();
+            }
+            stats[slot].add(p.y());
+        }
+    }
+
+    std::vector<int> order(xs.size());
+    for(std::size_t i=0;i<order.size();++i){
+        order[i]=int(i);
+    }
+    std::sort(order.begin(),order.end(),[&xs](int a,int b){
+        return xs[a]<xs[b];
+    });
+    std::vector<EnvelopePoint> result;
+    result.reserve(order.size());
+    for(int slot:order){
+        const RunningStats &s=stats[slot];
+        EnvelopePoint point;
+        point.x=xs[slot];
+        point.center=s.mean;
+        if(spec.type==EnvelopeSpec::ENV_SIGMA){
+            const double deviation=spec.sigmas*s.std();
+            point.low=s.mean-deviation;
+            point.high=s.mean+deviation;
+        }else{
+            point.low=s.min;
+            point.high=s.max;
+        }
+        result.push_back(point);
+    }
+    return result;
+}
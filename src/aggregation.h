@@ -0,0 +1,47 @@
+#ifndef AGGREGATION_H
+#define AGGREGATION_H
+
+#include <QList>
+#include <QPointF>
+#include <QString>
+#include <vector>
+
+#include "rowselection.h"
+#include "statistics.h"
+
+/*!
+ * \brief statistic of y values per distinct x value
+ */
+struct AggregationSpec{
+    enum Type {AGG_NONE,AGG_MEAN,AGG_MEDIAN,AGG_MIN,AGG_MAX,AGG_STD,AGG_COUNT,AGG_SUM,AGG_PERCENTILE};
+    Type type=AGG_NONE;
+    double percentile=50; // 0..100, for AGG_PERCENTILE
+
+    QString name() const;
+    bool needsValues() const;
+    double valueOf(const RunningStats &stats) const;
+};
+
+/*!
+ * \brief envelope of several series per x value
+ */
+struct EnvelopeSpec{
+    enum Type {ENV_NONE,ENV_MINMAX,ENV_SIGMA};
+    Type type=ENV_NONE;
+    double sigmas=3; // k of mean+-k*sigma, for ENV_SIGMA
+
+    QString name() const;
+};
+
+struct EnvelopePoint{
+    double x;
+    double low;
+    double center; // mean
+    double high;
+};
+
+QList<QPointF> aggregateRows(const double *x,const double *y,const RowSelection &rows,const AggregationSpec &spec,bool sortX=false);
+double percentileOf(std::vector<double> &values,double percentile);
+std::vector<EnvelopePoint> envelopeOf(const std::vector<QList<QPointF>> &series,std::size_t first,std::size_t last,const EnvelopeSpec &spec);
+
+#endif // AGGREGATION_H
@@ -0,0 +1,585 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "columnstore.h"
+
+#include <QRegularExpression>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QLocale>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+#include "hyperloglog.h"
+
+static const qsizetype minDictionaryLimit=1024; // distinct values always accepted for dictionary
+static const int rangeIndexThreshold=2; // range requests on a column before an index is built
+static const qsizetype maxBins=10000;
+static const qsizetype quantileSampleSize=1<<16; // values used to determine quantile edges
+static const double maxExactBinIndex=9007199254740992.; // 2^53, larger doubles skip integers
+
+ColumnStore::ColumnStore():m_data(nullptr),m_generation(0)
+{
+}
+/*!
+ * \brief attach to new data
+ * All cached information is dropped.
+ * \param data
+ * \param defaultType type which is assumed without checking (e.g. COL_FLOAT for s-parameter files)
+ */
+void ColumnStore::setData(const QVector<QStringList> *data,ColumnType defaultType)
+{
+    m_data=data;
+    m_cols=QVector<Column>(data ? data->size() : 0);
+    for(Column &col:m_cols){
+        col.type=defaultType;
+        col.defaultType=defaultType;
+        col.generation=++m_generation;
+    }
+}
+/*!
+ * \brief drop cached information of one column
+ * Needs to be called when the content of the column was changed.
+ * \param column
+ */
+void ColumnStore::invalidate(int column)
+{
+    if(column<0 || column>=m_cols.size()) return;
+    Column &col=m_cols[column];
+    col.type=col.defaultType;
+    col.generation=++m_generation;
+    col.statsValid=false;
+    col.numbersValid=false;
+    col.numbers=std::vector<double>();
+    col.dictState=Column::DICT_NONE;
+    col.dict=ColumnDictionary();
+    col.distinctValid=false;
+    col.distinct.clear();
+    col.sign=Column::SIGN_UNKNOWN;
+    col.rangeRequests=0;
+    col.index.reset();
+    col.estimateValid=false;
+    col.binsValid=false;
+    col.bins=ColumnDictionary();
+}
+
+/*!
+ * \brief generation of column content
+ * Changes whenever data is replaced or the column is invalidated.
+ * Can be used as part of keys for results derived from the column.
+ * \param column
+ * \return
+ */
+quint64 ColumnStore::generation(int column) const
+{
+    return m_cols.at(column).generation;
+}
+
+int ColumnStore::columnCount() const
+{
+    return m_cols.size();
+}
+
+qsizetype ColumnStore::rowCount() const
+{
+    if(!m_data || m_data->isEmpty()) return 0;
+    return m_data->first().size();
+}
+/*!
+ * \brief check what data type one column consists of
+ * String, int or float.
+ * Result is cached as it does not change.
+ * \param column
+ * \return
+ */
+ColumnType ColumnStore::type(int column)
+{
+    Column &col=m_cols[column];
+    if(col.type==COL_UNKNOWN){
+        col.type=detectType(column);
+    }
+    return col.type;
+}
+/*!
+ * \brief get (cached) statistics of column
+ * \param column
+ * \return
+ */
+const ColumnStats &ColumnStore::stats(int column)
+{
+    Column &col=m_cols[column];
+    if(!col.statsValid){
+        col.stats=computeStats(column);
+        col.statsValid=true;
+    }
+    return col.stats;
+}
+/*!
+ * \brief get column as numbers
+ * Cells which can not be interpreted as number are NaN.
+ * Int columns are converted with 0x/0b support.
+ * Conversion is done once in parallel and cached.
+ * \param column
+ * \return
+ */
+const std::vector<double> &ColumnStore::numbers(int column)
+{
+    Column &col=m_cols[column];
+    if(!col.numbersValid){
+        const QStringList &data=m_data->at(column);
+        const bool isInt=type(column)==COL_INT;
+        col.numbers.resize(data.size());
+        double *out=col.numbers.data();
+        parallelFor(data.size(),1<<14,[&data,out,isInt](qsizetype begin,qsizetype end){
+            for(qsizetype i=begin;i<end;++i){
+                bool ok;
+                double value= isInt ? double(toLong(data.at(i),ok)) : data.at(i).toDouble(&ok);
+                out[i]= ok ? value : std::numeric_limits<double>::quiet_NaN();
+            }
+        });
+        col.numbersValid=true;
+    }
+    return col.numbers;
+}
+/*!
+ * \brief get dictionary encoding of column
+ * Built once and cached. Columns with mostly distinct values (more than max(1024,rows/8))
+ * gain nothing from a dictionary, nullptr is returned for them.
+ * \param column
+ * \return dictionary or nullptr
+ */
+const ColumnDictionary *ColumnStore::dictionary(int column)
+{
+    Column &col=m_cols[column];
+    if(col.dictState==Column::DICT_NONE){
+        col.dictState= buildDictionary(column,col.dict) ? Column::DICT_VALID : Column::DICT_UNSUITED;
+        if(col.dictState==Column::DICT_UNSUITED){
+            col.dict=ColumnDictionary();
+        }
+    }
+    return col.dictState==Column::DICT_VALID ? &col.dict : nullptr;
+}
+/*!
+ * \brief distinct values of column in order of first occurrence
+ * Taken from the dictionary if the column has one, otherwise computed once and cached.
+ * \param column
+ * \return
+ */
+const QStringList &ColumnStore::distinctValues(int column)
+{
+    const ColumnDictionary *dict=dictionary(column);
+    if(dict) return dict->values;
+    Column &col=m_cols[column];
+    if(!col.distinctValid){
+        const QStringList &data=m_data->at(column);
+        QSet<QString> seen;
+        for(const QString &cell:data){
+            if(!seen.contains(cell)){
+                seen.insert(cell);
+                col.distinct.append(cell);
+            }
+        }
+        col.distinctValid=true;
+    }
+    return col.distinct;
+}
+/*!
+ * \brief check if column holds only numbers >= 0
+ * Result is cached until the column is invalidated.
+ * \param column
+ * \return
+ */
+bool ColumnStore::isNonNegative(int column)
+{
+    Column &col=m_cols[column];
+    if(col.sign==Column::SIGN_UNKNOWN){
+        bool ok=false;
+        const ColumnType colType=type(column);
+        if(colType==COL_INT || colType==COL_FLOAT){
+            ok=true;
+            for(double value:numbers(column)){
+                if(!(value>=0)){ // also catches NaN
+                    ok=false;
+                    break;
+                }
+            }
+        }
+        col.sign= ok ? Column::SIGN_NONNEGATIVE : Column::SIGN_OTHER;
+    }
+    return col.sign==Column::SIGN_NONNEGATIVE;
+}
+/*!
+ * \brief estimated number of distinct values of column
+ * Exact if the column already has a dictionary, otherwise a HyperLogLog sketch is built
+ * in parallel over blocks of rows. The estimate is cached.
+ * \param column
+ * \return
+ */
+double ColumnStore::distinctEstimate(int column)
+{
+    Column &col=m_cols[column];
+    if(col.dictState==Column::DICT_VALID){
+        return col.dict.values.size();
+    }
+    if(!col.estimateValid){
+        const QStringList &data=m_data->at(column);
+        HyperLogLog sketch;
+        QMutex mutex;
+        parallelFor(data.size(),1<<16,[&data,&sketch,&mutex](qsizetype begin,qsizetype end){
+            HyperLogLog partial;
+            for(qsizetype i=begin;i<end;++i){
+                partial.add(data.at(i));
+            }
+            QMutexLocker locker(&mutex);
+            sketch.merge(partial);
+        });
+        col.distinctEstimate=qMin(sketch.estimate(),double(data.size()));
+        col.estimateValid=true;
+    }
+    return col.distinctEstimate;
+}
+/*!
+ * \brief get sorted index for range filters on a numeric column
+ * Building the index costs more than one scan, so it is only built
+ * when the column is filtered repeatedly (on the second request).
+ * \param column
+ * \return index or nullptr if not (yet) worth it
+ */
+const SortedIndex *ColumnStore::rangeIndex(int column)
+{
+    Column &col=m_cols[column];
+    if(!col.index){
+        if(++col.rangeRequests<rangeIndexThreshold) return nullptr;
+        QSharedPointer<SortedIndex> index(new SortedIndex);
+        buildIndex(column,*index);
+        col.index=index;
+    }
+    return col.index.data();
+}
+/*!
+ * \brief bins of a numeric column as dictionary
+ * Values are the bin ranges, rows which are not numbers go into bin "NaN".
+ * The last requested binning is cached per column.
+ * \param column
+ * \param spec
+ * \return bins or nullptr if column is not numeric or binning would give too many bins
+ */
+const ColumnDictionary *ColumnStore::binning(int column, const BinSpec &spec)
+{
+    if(!spec.isActive()) return nullptr;
+    const ColumnType colType=type(column);
+    if(colType!=COL_INT && colType!=COL_FLOAT) return nullptr;
+    Column &col=m_cols[column];
+    if(!col.binsValid || !(col.binSpec==spec)){
+        col.bins=ColumnDictionary();
+        if(!buildBinning(column,spec,col.bins)){
+            col.bins=ColumnDictionary();
+        }
+        col.binSpec=spec;
+        col.binsValid=true;
+    }
+    if(col.bins.values.isEmpty()) return nullptr;
+    return &col.bins;
+}
+/*!
+ * \brief convert String to long
+ * Can handle 0x and 0b formats
+ * \param text
+ * \param ok
+ * \return
+ */
+qlonglong ColumnStore::toLong(const QString &text, bool &ok)
+{
+    qlonglong value;
+    if(text.startsWith("0b")){
+        value=text.mid(2).toLongLong(&ok,2);
+    }else{
+        if(text.startsWith("0x")){
+            value=text.mid(2).toLongLong(&ok,16);
+        }else{
+            value=text.toLongLong(&ok);
+        }
+    }
+    return value;
+}
+
+ColumnType ColumnStore::detectType(int column) const
+{
+    bool ok=true;
+    ColumnType result=COL_INT; // int -> float -> string
+    static const QRegularExpression reFloat("^\\s*[+-]?\\d+(\\.\\d+)?(e[+-]?\\d+)?$");
+    static const QRegularExpression reInt("^[+-]?\\d+$");
+    const QStringList &data=m_data->at(column);
+    for(qsizetype row=0;row<data.count();++row){
+        QString cell=data.at(row).simplified().toLower();
+        if(cell.startsWith("0x")){
+            cell.mid(2).toULongLong(&ok,16);
+            if(ok) continue;
+            result=COL_STRING;
+            break;
+        }
+        if(cell.startsWith("0b")){
+            cell.mid(2).toULongLong(&ok,2);
+            if(ok) continue;
+            result=COL_STRING;
+            break;
+        }
+        if(result==COL_INT){
+            QRegularExpressionMatch match = reInt.match(cell);
+            ok = match.hasMatch();
+            if(ok) continue;
+            result=COL_FLOAT;
+        }
+        QRegularExpressionMatch match = reFloat.match(cell);
+        ok = match.hasMatch();
+        if(ok) continue;
+        result=COL_STRING;
+        break;
+    }
+    return result;
+}
+/*!
+ * \brief one pass over column to gather statistics
+ * Bit width: maximum number of bits on all integer number in column
+ * \param column
+ * \return
+ */
+ColumnStats ColumnStore::computeStats(int column) const
+{
+    ColumnStats stats;
+    const QStringList &data=m_data->at(column);
+    quint64 mask=0;
+    for(qsizetype row=0;row<data.count();++row){
+        bool ok;
+        qlonglong value=toLong(data.at(row),ok);
+        if(!ok) break;
+        if(value<0){
+            stats.negative=true;
+            mask|=~quint64(value);
+        }else{
+            mask|=quint64(value);
+        }
+    }
+    int bits=0;
+    for(;mask!=0;++bits){
+        mask>>=1;
+    }
+    stats.bitWidth=stats.negative ? bits+1 : bits;
+    return stats;
+}
+/*!
+ * \brief encode column as codes into distinct values
+ * Stops early when the column has too many distinct values.
+ * \param column
+ * \param dict
+ * \return false if column is unsuited
+ */
+bool ColumnStore::buildDictionary(int column, ColumnDictionary &dict) const
+{
+    const QStringList &data=m_data->at(column);
+    const qsizetype limit=qMax(minDictionaryLimit,data.size()/8);
+    QHash<QString,quint32> lookup;
+    dict.codes.resize(data.size());
+    for(qsizetype row=0;row<data.size();++row){
+        const QString &cell=data.at(row);
+        auto it=lookup.constFind(cell);
+        quint32 code;
+        if(it==lookup.constEnd()){
+            if(dict.values.size()>=limit) return false;
+            code=dict.values.size();
+            lookup.insert(cell,code);
+            dict.values.append(cell);
+            dict.counts.push_back(0);
+        }else{
+            code=it.value();
+        }
+        dict.codes[row]=code;
+        ++dict.counts[code];
+    }
+    return true;
+}
+/*!
+ * \brief sort non-NaN numbers of column together with their rows
+ * \param column
+ * \param index
+ */
+void ColumnStore::buildIndex(int column, SortedIndex &index)
+{
+    const std::vector<double> &values=numbers(column);
+    std::vector<std::pair<double,int>> pairs; // sorted as pairs for locality, ties ordered by row
+    pairs.reserve(values.size());
+    for(qsizetype row=0;row<qsizetype(values.size());++row){
+        if(!std::isnan(values[row])){
+            pairs.emplace_back(values[row],int(row));
+        }
+    }
+    std::sort(pairs.begin(),pairs.end());
+    index.keys.resize(pairs.size());
+    index.rows.resize(pairs.size());
+    for(std::size_t i=0;i<pairs.size();++i){
+        index.keys[i]=pairs[i].first;
+        index.rows[i]=pairs[i].second;
+    }
+}
+/*!
+ * \brief find range of keys which lie between low and high
+ * \param low
+ * \param lowInclusive
+ * \param high
+ * \param highInclusive
+ * \param first first position in keys/rows
+ * \param last behind last position
+ */
+void SortedIndex::range(double low, bool lowInclusive, double high, bool highInclusive, qsizetype &first, qsizetype &last) const
+{
+    auto begin= lowInclusive ? std::lower_bound(keys.begin(),keys.end(),low) : std::upper_bound(keys.begin(),keys.end(),low);
+    auto end= highInclusive ? std::upper_bound(keys.begin(),keys.end(),high) : std::lower_bound(keys.begin(),keys.end(),high);
+    first=begin-keys.begin();
+    last=qMax(first,qsizetype(end-keys.begin()));
+}
+/*!
+ * \brief put numbers of column into bins
+ * Bin edges are determined first (min/max, sample or sorted values),
+ * then every row is assigned in one parallel pass.
+ * \param column
+ * \param spec
+ * \param bins
+ * \return false if there are no numbers or too many bins
+ */
+bool ColumnStore::buildBinning(int column, const BinSpec &spec, ColumnDictionary &bins)
+{
+    const std::vector<double> &values=numbers(column);
+    std::vector<double> edges; // lower edge per bin, ascending
+    double firstBin=0; // index of first fixed width bin
+    switch(spec.mode){
+    case BinSpec::BIN_WIDTH:
+    {
+        if(!(spec.parameter>0)) return false;
+        double low=std::numeric_limits<double>::infinity();
+        double high=-low;
+        for(double value:values){
+            if(value<low) low=value; // NaN compares false
+            if(value>high) high=value;
+        }
+        if(low>high) return false;
+        firstBin=std::floor(low/spec.parameter);
+        const double lastBin=std::floor(high/spec.parameter);
+        // bin indices must be exact integers in double, so neighbouring bins stay distinct
+        if(!std::isfinite(firstBin) || !std::isfinite(lastBin)) return false;
+        if(std::fabs(firstBin)>maxExactBinIndex || std::fabs(lastBin)>maxExactBinIndex) return false;
+        if(lastBin-firstBin+1>maxBins) return false;
+        const qsizetype binCount=qsizetype(lastBin-firstBin)+1;
+        for(qsizetype b=0;b<binCount;++b){
+            edges.push_back((firstBin+b)*spec.parameter);
+        }
+        break;
+    }
+    case BinSpec::BIN_QUANTILE:
+    {
+        const qsizetype count=qsizetype(spec.parameter);
+        if(count<1 || count>maxBins) return false;
+        const qsizetype stride=qMax<qsizetype>(1,qsizetype(values.size())/quantileSampleSize);
+        std::vector<double> sample;
+        for(std::size_t i=0;i<values.size();i+=stride){
+            if(!std::isnan(values[i])) sample.push_back(values[i]);
+        }
+        if(sample.empty()) return false;
+        std::sort(sample.begin(),sample.end());
+        for(qsizetype i=0;i<count;++i){
+            edges.push_back(sample[i*qsizetype(sample.size())/count]);
+        }
+        edges.erase(std::unique(edges.begin(),edges.end()),edges.end());
+        break;
+    }
+    case BinSpec::BIN_TOLERANCE:
+    {
+        if(!(spec.parameter>=0)) return false;
+        std::vector<double> sorted;
+        sorted.reserve(values.size());
+        for(double value:values){
+            if(!std::isnan(value)) sorted.push_back(value);
+        }
+        if(sorted.empty()) return false;
+        std::sort(sorted.begin(),sorted.end());
+        double start=sorted.front();
+        edges.push_back(start);
+        for(double value:sorted){
+            if(value-start>spec.parameter){
+                start=value;
+                edges.push_back(start);
+                if(qsizetype(edges.size())>maxBins) return false;
+            }
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    const quint32 binCount=quint32(edges.size());
+    const quint32 nanCode=binCount;
+    bins.codes.resize(values.size());
+    quint32 *codes=bins.codes.data();
+    const double *in=values.data();
+    const bool fixedWidth=spec.mode==BinSpec::BIN_WIDTH;
+    const double width=spec.parameter;
+    parallelFor(values.size(),1<<14,[&edges,codes,in,fixedWidth,width,firstBin,binCount,nanCode](qsizetype begin,qsizetype end){
+        for(qsizetype i=begin;i<end;++i){
+            const double value=in[i];
+            if(std::isnan(value)){
+                codes[i]=nanCode;
+                continue;
+            }
+            qsizetype bin;
+            if(fixedWidth){
+                // value is within [low,high], so the index is within the exact range checked above
+                bin=qsizetype(std::floor(value/width)-firstBin);
+            }else{
+                bin=std::upper_bound(edges.begin(),edges.end(),value)-edges.begin()-1;
+            }
+            codes[i]=quint32(qBound<qsizetype>(0,bin,binCount-1));
+        }
+    });
+
+    // labels: nominal range for fixed width, otherwise actual range of values in bin
+    bins.counts.assign(binCount+1,0);
+    std::vector<double> low(binCount,std::numeric_limits<double>::infinity());
+    std::vector<double> high(binCount,-std::numeric_limits<double>::infinity());
+    for(std::size_t i=0;i<values.size();++i){
+        const quint32 code=codes[i];
+        ++bins.counts[code];
+        if(code!=nanCode){
+            low[code]=qMin(low[code],in[i]);
+            high[code]=qMax(high[code],in[i]);
+        }
+    }
+    // edges need enough digits to tell neighbouring bins apart, e.g. width 0.1 at 1e6,
+    // values of the data are shown as short as they can be read back exactly
+    int precision=6;
+    if(fixedWidth && binCount>0){
+        const double magnitude=qMax(std::fabs(edges.front()),std::fabs(edges.back()+width));
+        if(magnitude>width){
+            precision=qBound(6,int(std::ceil(std::log10(magnitude/width)))+2,17);
+        }
+    }
+    for(quint32 bin=0;bin<binCount;++bin){
+        if(fixedWidth){
+            bins.values<<QString("[%1,%2)").arg(QString::number(edges[bin],'g',precision),QString::number(edges[bin]+width,'g',precision));
+        }else if(low[bin]==high[bin] || bins.counts[bin]==0){
+            bins.values<<QString::number(edges[bin],'g',QLocale::FloatingPointShortest);
+        }else{
+            bins.values<<QString("%1..%2").arg(QString::number(low[bin],'g',QLocale::FloatingPointShortest),
+                                               QString::number(high[bin],'g',QLocale::FloatingPointShortest));
+        }
+    }
+    bins.values<<"NaN";
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include <QStringList>
+#include <QVector>
+#include <QSharedPointer>
+#include <vector>
+
+enum ColumnType {COL_UNKNOWN,COL_STRING,COL_FLOAT,COL_INT};
+
+struct ColumnStats{
+    int bitWidth=0; // bits needed for largest integer, incl. sign bit
+    bool negative=false;
+};
+
+/*!
+ * \brief dictionary encoding of a column
+ * Distinct values in order of first occurrence, each row holds the index (code) of its value.
+ */
+struct ColumnDictionary{
+    std::vector<quint32> codes; // one per row
+    QStringList values;
+    std::vector<qsizetype> counts; // rows per value
+};
+
+/*!
+ * \brief numbers of a column in sorted order
+ * Rows with NaN are not contained.
+ */
+struct SortedIndex{
+    std::vector<double> keys; // ascending
+    std::vector<int> rows; // row of each key
+
+    void range(double low,bool lowInclusive,double high,bool highInclusive,qsizetype &first,qsizetype &last) const;
+};
+
+/*!
+ * \brief how numbers of a column are put into bins for grouping
+ * Fixed width bins, quantile bins (parameter is the number of bins)
+ * or clusters of values which differ by at most the tolerance from the smallest value of the cluster.
+ */
+struct BinSpec{
+    enum Mode {BIN_NONE,BIN_WIDTH,BIN_QUANTILE,BIN_TOLERANCE};
+    Mode mode=BIN_NONE;
+    double parameter=0; // bin width, number of bins or tolerance
+
+    bool isActive() const { return mode!=BIN_NONE; }
+    bool operator==(const BinSpec &other) const { return mode==other.mode && parameter==other.parameter; }
+};
+
+/*!
+ * \brief typed view on the csv data
+ * Holds lazily computed, cached information per column.
+ * The string data itself stays owned by MainWindow.
+ */
+class ColumnStore
+{
+public:
+    ColumnStore();
+
+    void setData(const QVector<QStringList> *data,ColumnType defaultType=COL_UNKNOWN);
+    void invalidate(int column);
+    quint64 generation(int column) const;
+
+    int columnCount() const;
+    qsizetype rowCount() const;
+
+    ColumnType type(int column);
+    const ColumnStats &stats(int column);
+    const std::vector<double> &numbers(int column);
+    const ColumnDictionary *dictionary(int column);
+    const SortedIndex *rangeIndex(int column);
+    const QStringList &distinctValues(int column);
+    const ColumnDictionary *binning(int column,const BinSpec &spec);
+    double distinctEstimate(int column);
+    bool isNonNegative(int column);
+
+    static qlonglong toLong(const QString &text,bool &ok);
+
+private:
+    struct Column{
+        ColumnType type=COL_UNKNOWN;
+        ColumnType defaultType=COL_UNKNOWN;
+        quint64 generation=0;
+        bool statsValid=false;
+        ColumnStats stats;
+        bool numbersValid=false;
+        std::vector<double> numbers;
+        enum DictState {DICT_NONE,DICT_VALID,DICT_UNSUITED};
+        DictState dictState=DICT_NONE;
+        ColumnDictionary dict;
+        bool distinctValid=false;
+        QStringList distinct; // only used if there is no dictionary
+        enum SignState {SIGN_UNKNOWN,SIGN_NONNEGATIVE,SIGN_OTHER};
+        SignState sign=SIGN_UNKNOWN;
+        int rangeRequests=0;
+        QSharedPointer<SortedIndex> index;
+        bool estimateValid=false;
+        double distinctEstimate=0;
+        bool binsValid=false;
+        BinSpec binSpec;
+        ColumnDictionary bins; // empty if binning failed
+    };
+    ColumnType detectType(int column) const;
+    ColumnStats computeStats(int column) const;
+    bool buildDictionary(int column,ColumnDictionary &dict) const;
+    void buildIndex(int column,SortedIndex &index);
+    bool buildBinning(int column,const BinSpec &spec,ColumnDictionary &bins);
+
+    const QVector<QStringList> *m_data;
+    QVector<Column> m_cols;
+    quint64 m_generation; // last generation handed out
+};
+
+#endif // COLUMNSTORE_H
@@ -0,0 +1,244 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "csvtablemodel.h"
+
+#include <QApplication>
+#include <QPalette>
+#include <QColor>
+#include <algorithm>
+#include <cmath>
+
+CsvTableModel::CsvTableModel(QObject *parent)
+    : QAbstractTableModel(parent),m_columns(nullptr),m_data(nullptr),m_store(nullptr),m_rowsFiltered(false)
+{
+}
+/*!
+ * \brief set data source
+ * Display formats and filter states are reset.
+ * \param columns header names
+ * \param data column data
+ * \param store typed info on data
+ */
+void CsvTableModel::setSource(const QStringList *columns, const QVector<QStringList> *data, ColumnStore *store)
+{
+    beginResetModel();
+    m_columns=columns;
+    m_data=data;
+    m_store=store;
+    const int n=m_columns ? m_columns->size() : 0;
+    m_formats=QVector<ColumnFormat>(n);
+    m_filterStates=QVector<FilterState>(n,FILTER_NONE);
+    m_rows.clear();
+    m_rowsFiltered=false;
+    endResetModel();
+}
+
+int CsvTableModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid() || !m_data || m_data->isEmpty()) return 0;
+    if(m_rowsFiltered) return static_cast<int>(m_rows.size());
+    return m_data->first().size();
+}
+
+int CsvTableModel::columnCount(const QModelIndex &parent) const
+{
+    if(parent.isValid() || !m_columns) return 0;
+    return m_columns->size();
+}
+
+QVariant CsvTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid()) return QVariant();
+    const int column=index.column();
+    if(role==Qt::DisplayRole){
+        const QStringList &colVals=m_data->at(column);
+        const int row=sourceRow(index.row());
+        if(row<0 || row>=colVals.size()) return QVariant();
+        return formatValue(column,colVals.at(row));
+    }
+    if(role==Qt::BackgroundRole){
+        if(m_filterStates.value(column)!=FILTER_NONE){
+            return QColor(Qt::cyan);
+        }
+    }
+    return QVariant();
+}
+
+QVariant CsvTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation==Qt::Vertical){
+        if(role==Qt::DisplayRole){
+            return sourceRow(section)+1;
+        }
+        return QVariant();
+    }
+    if(!m_columns || section<0 || section>=m_columns->size()) return QVariant();
+    if(role==Qt::DisplayRole){
+        return m_columns->at(section);
+    }
+    if(role==Qt::BackgroundRole){
+        switch(m_filterStates.value(section)){
+        case FILTER_ACTIVE:
+            return QApplication::palette().color(QPalette::Midlight);
+        case FILTER_OFF:
+            return QColor(Qt::red);
+        default:
+            break;
+        }
+    }
+    return QVariant();
+}
+/*!
+ * \brief set how the values of a column are shown
+ * The bit width for hex/binary is taken once from the column statistics,
+ * the actual formatting is done when a cell is painted.
+ * \param column
+ * \param format
+ * \param precision digits for fixed/engineering format
+ */
+void CsvTableModel::setDisplayFormat(int column, DisplayFormat format, int precision)
+{
+    if(column<0 || column>=m_formats.size()) return;
+    ColumnFormat &fmt=m_formats[column];
+    fmt.format=format;
+    fmt.precision=precision;
+    if(format==FMT_HEX || format==FMT_BINARY){
+        fmt.bitWidth=qMax(1,m_store->stats(column).bitWidth);
+    }
+    columnChanged(column);
+}
+
+CsvTableModel::DisplayFormat CsvTableModel::displayFormat(int column) const
+{
+    return m_formats.value(column).format;
+}
+/*!
+ * \brief format cell text according to display format of column
+ * Text which can not be interpreted as number is returned unchanged.
+ * \param column
+ * \param text
+ * \return
+ */
+QString CsvTableModel::formatValue(int column, const QString &text) const
+{
+    const ColumnFormat &fmt=m_formats.at(column);
+    switch(fmt.format){
+    case FMT_DEFAULT:
+        return text;
+    case FMT_DECIMAL:
+    case FMT_HEX:
+    case FMT_BINARY:
+    {
+        bool ok;
+        qlonglong value=ColumnStore::toLong(text,ok);
+        if(!ok) return text;
+        if(fmt.format==FMT_DECIMAL){
+            return QString::number(value);
+        }
+        // 2er complement
+        quint64 mask= fmt.bitWidth>=64 ? ~quint64(0) : (quint64(1)<<fmt.bitWidth)-1;
+        quint64 uvalue=quint64(value)&mask;
+        if(fmt.format==FMT_HEX){
+            int digits=(fmt.bitWidth+3)/4;
+            return QString("0x%1").arg(uvalue,digits,16,QChar('0'));
+        }
+        return QString("0b%1").arg(uvalue,fmt.bitWidth,2,QChar('0'));
+    }
+    case FMT_FIXED:
+    case FMT_ENGINEERING:
+    {
+        bool ok;
+        double value=text.toDouble(&ok);
+        if(!ok) return text;
+        if(fmt.format==FMT_FIXED){
+            return QString::number(value,'f',fmt.precision);
+        }
+        if(value==0 || !std::isfinite(value)){
+            return QString::number(value);
+        }
+        // exponent as multiple of 3
+        int exponent=static_cast<int>(std::floor(std::log10(std::fabs(value))/3))*3;
+        double mantissa=value/std::pow(10.,exponent);
+        QString result=QString::number(mantissa,'f',fmt.precision);
+        if(exponent!=0){
+            result+=QString("e%1").arg(exponent);
+        }
+        return result;
+    }
+    }
+    return text;
+}
+/*!
+ * \brief set filter state of column which is used for coloring
+ * \param column
+ * \param state
+ */
+void CsvTableModel::setFilterState(int column, FilterState state)
+{
+    if(column<0 || column>=m_filterStates.size()) return;
+    m_filterStates[column]=state;
+    emit headerDataChanged(Qt::Horizontal,column,column);
+    columnChanged(column);
+}
+/*!
+ * \brief only show rows which are marked as visible
+ * \param visibleRows
+ */
+void CsvTableModel::setVisibleRows(const RowSelection &visibleRows)
+{
+    beginResetModel();
+    m_rows.clear();
+    m_rowsFiltered=false;
+    if(!visibleRows.isEmpty() && !visibleRows.all()){
+        m_rows=visibleRows.rows();
+        m_rowsFiltered=true;
+    }
+    endResetModel();
+}
+/*!
+ * \brief map row of view to row in data
+ * \param row
+ * \return
+ */
+int CsvTableModel::sourceRow(int row) const
+{
+    if(!m_rowsFiltered) return row;
+    if(row<0 || row>=static_cast<int>(m_rows.size())) return -1;
+    return m_rows[row];
+}
+/*!
+ * \brief map row in data to row of view
+ * \param sourceRow
+ * \return -1 if row is filtered out
+ */
+int CsvTableModel::viewRow(int sourceRow) const
+{
+    if(!m_rowsFiltered) return sourceRow;
+    auto it=std::lower_bound(m_rows.begin(),m_rows.end(),sourceRow);
+    if(it==m_rows.end() || *it!=sourceRow) return -1;
+    return static_cast<int>(it-m_rows.begin());
+}
+/*!
+ * \brief data rows shown in view
+ * \return nullptr if all rows are shown
+ */
+const std::vector<int> *CsvTableModel::rowMap() const
+{
+    return m_rowsFiltered ? &m_rows : nullptr;
+}
+/*!
+ * \brief notify views that content of column changed
+ * \param column
+ */
+void CsvTableModel::columnChanged(int column)
+{
+    const int rows=rowCount();
+    if(rows==0) return;
+    emit dataChanged(index(0,column),index(rows-1,column));
+}
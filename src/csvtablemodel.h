@@ -0,0 +1,61 @@
+#ifndef CSVTABLEMODEL_H
+#define CSVTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+
+#include "columnstore.h"
+#include "rowselection.h"
+
+/*!
+ * \brief table model which serves the csv data to the table view
+ * Cells are formatted on request, i.e. only visible cells are touched.
+ * Filtered rows are left out by mapping view rows to data rows.
+ */
+class CsvTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum DisplayFormat {FMT_DEFAULT,FMT_DECIMAL,FMT_HEX,FMT_BINARY,FMT_ENGINEERING,FMT_FIXED};
+    enum FilterState {FILTER_NONE,FILTER_ACTIVE,FILTER_OFF};
+
+    CsvTableModel(QObject *parent = nullptr);
+
+    void setSource(const QStringList *columns,const QVector<QStringList> *data,ColumnStore *store);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void setDisplayFormat(int column,DisplayFormat format,int precision=3);
+    DisplayFormat displayFormat(int column) const;
+    QString formatValue(int column,const QString &text) const;
+
+    void setFilterState(int column,FilterState state);
+    void setVisibleRows(const RowSelection &visibleRows);
+    int sourceRow(int row) const;
+    int viewRow(int sourceRow) const;
+    const std::vector<int> *rowMap() const;
+    void columnChanged(int column);
+
+private:
+    struct ColumnFormat{
+        DisplayFormat format=FMT_DEFAULT;
+        int precision=3;
+        int bitWidth=0;
+    };
+
+    const QStringList *m_columns;
+    const QVector<QStringList> *m_data;
+    ColumnStore *m_store;
+
+    QVector<ColumnFormat> m_formats;
+    QVector<FilterState> m_filterStates;
+    std::vector<int> m_rows;
+    bool m_rowsFiltered;
+};
+
+#endif // CSVTABLEMODEL_H
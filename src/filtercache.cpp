@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "filtercache.h"
+
+#include <limits>
+
+FilterCache::FilterCache():m_hits(0),m_misses(0)
+{
+}
+/*!
+ * \brief look up result, marks entry as recently used
+ * \param key
+ * \return null if not cached
+ */
+QSharedPointer<RowSelection> FilterCache::find(const QString &key)
+{
+    QSharedPointer<RowSelection> *entry=m_cache.object(key);
+    if(!entry){
+        ++m_misses;
+        return QSharedPointer<RowSelection>();
+    }
+    ++m_hits;
+    return *entry;
+}
+/*!
+ * \brief add result, least recently used entries are dropped when over budget
+ * Results larger than the whole budget are not stored.
+ * \param key
+ * \param result
+ */
+void FilterCache::insert(const QString &key, const QSharedPointer<RowSelection> &result)
+{
+    const qint64 cost=result->memoryUsage()/1024+1;
+    if(cost>m_cache.maxCost()) return;
+    m_cache.insert(key,new QSharedPointer<RowSelection>(result),static_cast<int>(cost));
+}
+
+void FilterCache::clear()
+{
+    m_cache.clear();
+}
+
+void FilterCache::setBudget(qint64 bytes)
+{
+    const qint64 kib=qMin<qint64>(bytes/1024,std::numeric_limits<int>::max());
+    m_cache.setMaxCost(kib);
+}
+
+qint64 FilterCache::budget() const
+{
+    return qint64(m_cache.maxCost())*1024;
+}
+
+qint64 FilterCache::memoryUsage() const
+{
+    return qint64(m_cache.totalCost())*1024;
+}
+
+int FilterCache::entryCount() const
+{
+    return m_cache.count();
+}
+
+qint64 FilterCache::hits() const
+{
+    return m_hits;
+}
+
+qint64 FilterCache::misses() const
+{
+    return m_misses;
+}
@@ -0,0 +1,38 @@
+#ifndef FILTERCACHE_H
+#define FILTERCACHE_H
+
+#include <QCache>
+#include <QSharedPointer>
+#include <QString>
+
+#include "rowselection.h"
+
+/*!
+ * \brief least recently used cache of filter results
+ * Key contains column, normalized query and data generation of the column,
+ * so entries never need explicit invalidation.
+ * Memory usage is limited by budget.
+ */
+class FilterCache
+{
+public:
+    FilterCache();
+
+    QSharedPointer<RowSelection> find(const QString &key);
+    void insert(const QString &key,const QSharedPointer<RowSelection> &result);
+    void clear();
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+    qint64 memoryUsage() const;
+    int entryCount() const;
+    qint64 hits() const;
+    qint64 misses() const;
+
+private:
+    QCache<QString,QSharedPointer<RowSelection>> m_cache; // cost in KiB
+    qint64 m_hits;
+    qint64 m_misses;
+};
+
+#endif // FILTERCACHE_H
@@ -0,0 +1,243 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "filtereditor.h"
+
+#include <QLineEdit>
+#include <QLabel>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+#include <QTimer>
+#include <QThread>
+#include <vector>
+
+#include "filterquery.h"
+#include "parallel.h"
+
+static const qsizetype countBlockSize=1<<15;
+static const int sampleBlocks=64; // evenly spread over the column
+static const qsizetype sampleBlockSize=1<<10;
+
+FilterEditor::FilterEditor(QWidget *parent)
+    : QDialog(parent),m_data(nullptr),m_store(nullptr),m_column(-1),m_contextCount(0),m_thread(nullptr),m_evaluationId(0)
+{
+    setWindowTitle(tr("Column filter"));
+    setModal(false);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    lblColumn = new QLabel;
+    mainLayout->addWidget(lblColumn);
+    leQuery = new QLineEdit;
+    leQuery->setPlaceholderText(tr("use ><=&|contains"));
+    mainLayout->addWidget(leQuery);
+    lblCount = new QLabel;
+    mainLayout->addWidget(lblCount);
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Apply|QDialogButtonBox::Cancel);
+    connect(buttonBox,&QDialogButtonBox::accepted,this,[this](){
+        apply();
+        accept();
+    });
+    connect(buttonBox,&QDialogButtonBox::rejected,this,&QDialog::reject);
+    connect(buttonBox->button(QDialogButtonBox::Apply),&QPushButton::clicked,this,&FilterEditor::apply);
+    mainLayout->addWidget(buttonBox);
+    setLayout(mainLayout);
+
+    // evaluate once typing pauses, a running evaluation is outdated immediately
+    m_editTimer = new QTimer(this);
+    m_editTimer->setSingleShot(true);
+    m_editTimer->setInterval(200);
+    connect(m_editTimer,&QTimer::timeout,this,&FilterEditor::startEvaluation);
+    connect(leQuery,&QLineEdit::textEdited,this,[this](){
+        if(m_cancel){
+            *m_cancel=true;
+        }
+        m_editTimer->start();
+    });
+    connect(this,&QDialog::finished,this,&FilterEditor::stopEvaluation);
+    resize(400,120);
+}
+
+FilterEditor::~FilterEditor()
+{
+    stopEvaluation();
+}
+/*!
+ * \brief set data the filter is evaluated on
+ * A running evaluation is stopped.
+ * \param data
+ * \param store
+ */
+void FilterEditor::setSource(const QVector<QStringList> *data, ColumnStore *store)
+{
+    stopEvaluation();
+    m_data=data;
+    m_store=store;
+    m_column=-1;
+    m_context.reset();
+    lblColumn->clear();
+    lblCount->clear();
+}
+/*!
+ * \brief edit filter of column
+ * \param column
+ * \param name column name
+ * \param query current query
+ * \param context rows passing all other filters, counts are given relative to them
+ */
+void FilterEditor::setColumn(int column, const QString &name, const QString &query, const RowSelection &context)
+{
+    stopEvaluation();
+    m_column=column;
+    lblColumn->setText(tr("Filter on %1:").arg(name));
+    leQuery->setText(query);
+    setContext(context);
+}
+/*!
+ * \brief rows passing the other filters changed, or data of the column changed
+ * The query is compiled for the current column type and counted again.
+ * \param context rows passing all other filters
+ */
+void FilterEditor::setContext(const RowSelection &context)
+{
+    stopEvaluation();
+    m_context.reset();
+    if(context.all()){
+        m_contextCount=context.size();
+    }else{
+        m_context.reset(new RowSelection(context));
+        m_context->makeDense(); // evaluation is and-ed word-wise
+        m_contextCount=m_context->count();
+    }
+    startEvaluation();
+}
+
+int FilterEditor::column() const
+{
+    return m_column;
+}
+
+QString FilterEditor::query() const
+{
+    return leQuery->text();
+}
+/*!
+ * \brief cancel running evaluation and wait for it to end
+ */
+void FilterEditor::stopEvaluation()
+{
+    m_editTimer->stop();
+    if(!m_thread) return;
+    *m_cancel=true;
+    m_thread->wait();
+    delete m_thread;
+    m_thread=nullptr;
+}
+/*!
+ * \brief count rows passing the current query in background
+ * A sample of rows gives an estimate first, the full scan then gives the exact count.
+ */
+void FilterEditor::startEvaluation()
+{
+    stopEvaluation();
+    const int evaluationId=++m_evaluationId; // results of previous evaluations are ignored
+    if(!m_data || m_column<0 || m_column>=m_data->size()) return;
+    QSharedPointer<FilterQuery> query(new FilterQuery);
+    if(!query->compile(leQuery->text(),m_store->type(m_column))){
+        lblCount->setText(tr("no filter, %1 rows").arg(m_contextCount));
+        return;
+    }
+    // prepare typed data in GUI thread, evaluation threads only read
+    FilterInput input;
+    input.cells=&m_data->at(m_column);
+    if(query->isNumeric()){
+        input.numbers=m_store->numbers(m_column).data();
+    }
+    if(query->hasTextTerms()){
+        input.dictionary=m_store->dictionary(m_column);
+    }
+    const qsizetype rows=input.cells->size();
+    QSharedPointer<const RowSelection> context=m_context;
+
+    lblCount->setText(tr("counting ..."));
+    m_cancel=std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<bool>> cancel=m_cancel;
+    m_thread=QThread::create([this,evaluationId,query,input,context,rows,cancel](){
+        query->prepare(input);
+        const quint64 *contextWords= context ? context->words() : nullptr;
+        auto countBlock=[&query,&input,contextWords](qsizetype begin,qsizetype end){
+            const qsizetype wordCount=RowSelection::wordsFor(end-begin);
+            std::vector<quint64> pass(wordCount);
+            query->evaluate(input,begin,end,pass.data());
+            const int rest=(end-begin)&63;
+            if(rest!=0){
+                pass[wordCount-1]&=(quint64(1)<<rest)-1;
+            }
+            qsizetype count=0;
+            for(qsizetype w=0;w<wordCount;++w){
+                quint64 bits=pass[w];
+                if(contextWords){
+                    bits&=contextWords[begin/64+w];
+                }
+                count+=qPopulationCount(bits);
+            }
+            return count;
+        };
+        if(rows>=4*sampleBlocks*sampleBlockSize){
+            // estimate from evenly spread blocks, block starts are word aligned
+            const qsizetype step=(rows/sampleBlocks)&~qsizetype(63);
+            qsizetype passed=0,sampled=0;
+            for(int i=0;i<sampleBlocks && !*cancel;++i){
+                const qsizetype begin=i*step;
+                const qsizetype end=qMin(rows,begin+sampleBlockSize);
+                passed+=countBlock(begin,end);
+                sampled+=end-begin;
+            }
+            if(*cancel) return;
+            const qsizetype estimate=qRound64(double(passed)*rows/sampled);
+            QMetaObject::invokeMethod(this,[this,evaluationId,estimate](){
+                if(evaluationId==m_evaluationId){
+                    showCount(estimate,false);
+                }
+            },Qt::QueuedConnection);
+        }
+        std::atomic<qsizetype> count{0};
+        parallelFor(rows,countBlockSize,[&](qsizetype begin,qsizetype end){
+            if(*cancel) return;
+            count+=countBlock(begin,end);
+        });
+        if(*cancel) return;
+        const qsizetype exact=count;
+        QMetaObject::invokeMethod(this,[this,evaluationId,exact](){
+            if(evaluationId==m_evaluationId){
+                showCount(exact,true);
+            }
+        },Qt::QueuedConnection);
+    });
+    m_thread->start();
+}
+/*!
+ * \brief show number of rows passing the query
+ * \param count
+ * \param exact false for estimate from sample
+ */
+void FilterEditor::showCount(qsizetype count, bool exact)
+{
+    if(exact){
+        lblCount->setText(tr("%1 of %2 rows pass").arg(count).arg(m_contextCount));
+    }else{
+        lblCount->setText(tr("about %1 of %2 rows pass, counting ...").arg(qMin(count,m_contextCount)).arg(m_contextCount));
+    }
+}
+/*!
+ * \brief apply query as column filter
+ */
+void FilterEditor::apply()
+{
+    if(m_column<0) return;
+    emit filterApplied(m_column,leQuery->text());
+}
@@ -0,0 +1,64 @@
+#ifndef FILTEREDITOR_H
+#define FILTEREDITOR_H
+
+#include <QDialog>
+#include <QVector>
+#include <QStringList>
+#include <QSharedPointer>
+#include <atomic>
+#include <memory>
+
+#include "columnstore.h"
+#include "rowselection.h"
+
+class QLineEdit;
+class QLabel;
+class QTimer;
+class QThread;
+
+/*!
+ * \brief non-modal editor for column filter queries
+ * While typing, the query is evaluated in a background thread:
+ * first an estimate from a sample of rows, then the exact count.
+ * A new edit cancels the running evaluation.
+ */
+class FilterEditor : public QDialog
+{
+    Q_OBJECT
+public:
+    FilterEditor(QWidget *parent = nullptr);
+    ~FilterEditor();
+
+    void setSource(const QVector<QStringList> *data,ColumnStore *store);
+    void setColumn(int column,const QString &name,const QString &query,const RowSelection &context);
+    void setContext(const RowSelection &context);
+    int column() const;
+    QString query() const;
+    void stopEvaluation();
+
+signals:
+    void filterApplied(int column,const QString &query);
+
+protected:
+    void startEvaluation();
+    void showCount(qsizetype count,bool exact);
+    void apply();
+
+private:
+    QLabel *lblColumn;
+    QLineEdit *leQuery;
+    QLabel *lblCount;
+    QTimer *m_editTimer;
+
+    const QVector<QStringList> *m_data;
+    ColumnStore *m_store;
+    int m_column;
+    QSharedPointer<RowSelection> m_context; // rows passing the other filters, null if all
+    qsizetype m_contextCount;
+
+    QThread *m_thread;
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+    int m_evaluationId;
+};
+
+#endif // FILTEREDITOR_H
@@ -0,0 +1,201 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "filterkernels.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define DE_KERNEL_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DE_KERNEL_SSE2
+#endif
+
+template <FilterNode::Op op>
+static inline bool compareScalar(double v,double r)
+{
+    if constexpr(op==FilterNode::OP_GT) return v>r;
+    if constexpr(op==FilterNode::OP_GE) return v>=r;
+    if constexpr(op==FilterNode::OP_EQ) return v==r;
+    if constexpr(op==FilterNode::OP_LE) return v<=r;
+    if constexpr(op==FilterNode::OP_LT) return v<r;
+    return v!=r;
+}
+
+#if defined(DE_KERNEL_AVX)
+template <FilterNode::Op op>
+static inline __m256d compareVector(__m256d v,__m256d r)
+{
+    if constexpr(op==FilterNode::OP_GT) return _mm256_cmp_pd(v,r,_CMP_GT_OQ);
+    if constexpr(op==FilterNode::OP_GE) return _mm256_cmp_pd(v,r,_CMP_GE_OQ);
+    if constexpr(op==FilterNode::OP_EQ) return _mm256_cmp_pd(v,r,_CMP_EQ_OQ);
+    if constexpr(op==FilterNode::OP_LE) return _mm256_cmp_pd(v,r,_CMP_LE_OQ);
+    if constexpr(op==FilterNode::OP_LT) return _mm256_cmp_pd(v,r,_CMP_LT_OQ);
+    return _mm256_cmp_pd(v,r,_CMP_NEQ_UQ); // NaN != r is true as in C++
+}
+#elif defined(DE_KERNEL_SSE2)
+template <FilterNode::Op op>
+static inline __m128d compareVector(__m128d v,__m128d r)
+{
+    if constexpr(op==FilterNode::OP_GT) return _mm_cmpgt_pd(v,r);
+    if constexpr(op==FilterNode::OP_GE) return _mm_cmpge_pd(v,r);
+    if constexpr(op==FilterNode::OP_EQ) return _mm_cmpeq_pd(v,r);
+    if constexpr(op==FilterNode::OP_LE) return _mm_cmple_pd(v,r);
+    if constexpr(op==FilterNode::OP_LT) return _mm_cmplt_pd(v,r);
+    return _mm_cmpneq_pd(v,r);
+}
+#endif
+/*!
+ * \brief compare 64 values at a time and pack the results into one word
+ * \param values
+ * \param count
+ * \param reference
+ * \param words ceil(count/64) words are written, bits behind count are zero
+ */
+template <FilterNode::Op op>
+static void compareWords(const double *values,qsizetype count,double reference,quint64 *words)
+{
+    const qsizetype fullWords=count/64;
+#if defined(DE_KERNEL_AVX)
+    const __m256d r=_mm256_set1_pd(reference);
+    for(qsizetype w=0;w<fullWords;++w){
+        const double *p=values+w*64;
+        quint64 bits=0;
+        for(int j=0;j<64;j+=4){
+            const int mask=_mm256_movemask_pd(compareVector<op>(_mm256_loadu_pd(p+j),r));
+            bits|=quint64(mask)<<j;
+        }
+        words[w]=bits;
+    }
+#elif defined(DE_KERNEL_SSE2)
+    const __m128d r=_mm_set1_pd(reference);
+    for(qsizetype w=0;w<fullWords;++w){
+        const double *p=values+w*64;
+        quint64 bits=0;
+        for(int j=0;j<64;j+=2){
+            const int mask=_mm_movemask_pd(compareVector<op>(_mm_loadu_pd(p+j),r));
+            bits|=quint64(mask)<<j;
+        }
+        words[w]=bits;
+    }
+#else
+    for(qsizetype w=0;w<fullWords;++w){
+        const double *p=values+w*64;
+        quint64 bits=0;
+        for(int j=0;j<64;++j){
+            bits|=quint64(compareScalar<op>(p[j],reference))<<j;
+        }
+        words[w]=bits;
+    }
+#endif
+    const qsizetype rest=count-fullWords*64;
+    if(rest>0){
+        const double *p=values+fullWords*64;
+        quint64 bits=0;
+        for(qsizetype j=0;j<rest;++j){
+            bits|=quint64(compareScalar<op>(p[j],reference))<<j;
+        }
+        words[fullWords]=bits;
+    }
+}
+/*!
+ * \brief compare values against reference and write result as bitmap
+ * \param values
+ * \param count
+ * \param op
+ * \param reference
+ * \param words ceil(count/64) words
+ */
+void compareKernel(const double *values, qsizetype count, FilterNode::Op op, double reference, quint64 *words)
+{
+    switch(op){
+    case FilterNode::OP_GT: compareWords<FilterNode::OP_GT>(values,count,reference,words); break;
+    case FilterNode::OP_GE: compareWords<FilterNode::OP_GE>(values,count,reference,words); break;
+    case FilterNode::OP_EQ: compareWords<FilterNode::OP_EQ>(values,count,reference,words); break;
+    case FilterNode::OP_LE: compareWords<FilterNode::OP_LE>(values,count,reference,words); break;
+    case FilterNode::OP_LT: compareWords<FilterNode::OP_LT>(values,count,reference,words); break;
+    case FilterNode::OP_NE: compareWords<FilterNode::OP_NE>(values,count,reference,words); break;
+    }
+}
+
+enum BitOp {BIT_AND,BIT_OR,BIT_ANDNOT};
+
+template <BitOp op>
+static inline quint64 combineScalar(quint64 a,quint64 b)
+{
+    if constexpr(op==BIT_AND) return a&b;
+    if constexpr(op==BIT_OR) return a|b;
+    return a&~b;
+}
+/*!
+ * \brief combine other word-wise into words
+ * \param words
+ * \param other
+ * \param wordCount
+ */
+template <BitOp op>
+static void combineWords(quint64 *words,const quint64 *other,qsizetype wordCount)
+{
+    qsizetype i=0;
+#if defined(__AVX2__)
+    for(;i+4<=wordCount;i+=4){
+        __m256i a=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words+i));
+        const __m256i b=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(other+i));
+        if constexpr(op==BIT_AND) a=_mm256_and_si256(a,b);
+        else if constexpr(op==BIT_OR) a=_mm256_or_si256(a,b);
+        else a=_mm256_andnot_si256(b,a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words+i),a);
+    }
+#elif defined(DE_KERNEL_AVX) || defined(DE_KERNEL_SSE2)
+    for(;i+2<=wordCount;i+=2){
+        __m128i a=_mm_loadu_si128(reinterpret_cast<const __m128i*>(words+i));
+        const __m128i b=_mm_loadu_si128(reinterpret_cast<const __m128i*>(other+i));
+        if constexpr(op==BIT_AND) a=_mm_and_si128(a,b);
+        else if constexpr(op==BIT_OR) a=_mm_or_si128(a,b);
+        else a=_mm_andnot_si128(b,a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(words+i),a);
+    }
+#endif
+    for(;i<wordCount;++i){
+        words[i]=combineScalar<op>(words[i],other[i]);
+    }
+}
+
+void andKernel(quint64 *words, const quint64 *other, qsizetype wordCount)
+{
+    combineWords<BIT_AND>(words,other,wordCount);
+}
+
+void orKernel(quint64 *words, const quint64 *other, qsizetype wordCount)
+{
+    combineWords<BIT_OR>(words,other,wordCount);
+}
+/*!
+ * \brief remove bits of other from words
+ * \param words
+ * \param other
+ * \param wordCount
+ */
+void andNotKernel(quint64 *words, const quint64 *other, qsizetype wordCount)
+{
+    combineWords<BIT_ANDNOT>(words,other,wordCount);
+}
+/*!
+ * \brief name of the instruction set the kernels were compiled for
+ * \return
+ */
+const char *kernelInstructionSet()
+{
+#if defined(DE_KERNEL_AVX)
+    return "AVX";
+#elif defined(DE_KERNEL_SSE2)
+    return "SSE2";
+#else
+    return "generic";
+#endif
+}
@@ -0,0 +1,15 @@
+#ifndef FILTERKERNELS_H
+#define FILTERKERNELS_H
+
+#include <QtGlobal>
+
+#include "filterquery.h"
+
+void compareKernel(const double *values,qsizetype count,FilterNode::Op op,double reference,quint64 *words);
+void andKernel(quint64 *words,const quint64 *other,qsizetype wordCount);
+void orKernel(quint64 *words,const quint64 *other,qsizetype wordCount);
+void andNotKernel(quint64 *words,const quint64 *other,qsizetype wordCount);
+
+const char *kernelInstructionSet();
+
+#endif // FILTERKERNELS_H
@@ -0,0 +1,408 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "filterquery.h"
+#include "filterkernels.h"
+#include "rowselection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/*!
+ * \brief evaluate predicate per row and pack the results into bitmap words
+ * \param count rows
+ * \param words ceil(count/64) words, bits behind count are zero
+ * \param pass
+ */
+template <typename Predicate>
+static void packRange(qsizetype count,quint64 *words,Predicate pass)
+{
+    for(qsizetype w=0;w*64<count;++w){
+        const qsizetype n=std::min<qsizetype>(64,count-w*64);
+        quint64 bits=0;
+        for(qsizetype j=0;j<n;++j){
+            bits|=quint64(pass(w*64+j))<<j;
+        }
+        words[w]=bits;
+    }
+}
+
+FilterQuery::FilterQuery():m_numeric(false),m_textTerms(false)
+{
+}
+/*!
+ * \brief compile query text
+ * Constants are converted and regexes are compiled here once.
+ * Unknown terms are skipped.
+ * \param text
+ * \param type column type, int/float columns are compared numerically
+ * \return false if query contains no valid term
+ */
+bool FilterQuery::compile(const QString &text, ColumnType type)
+{
+    m_text=text;
+    m_numeric= type==COL_INT || type==COL_FLOAT;
+    m_textTerms=false;
+    m_root.reset();
+    bool connectAnd=true; // connector to previous term
+    for(int start=0;start<text.length();){
+        int end=text.indexOf('&',start);
+        int end_=text.indexOf('|',start);
+        bool andOperator=true;
+        if(end_>=0 && (end_<end || end<0) ){
+            end=end_;
+            andOperator=false;
+        }
+        QString term= end>=0 ? text.mid(start,end-start).trimmed() : text.mid(start).trimmed();
+        start= end>=0 ? end+1 : text.length();
+
+        QString reference;
+        int operatorType=determineOperator(term,reference);
+        if(operatorType<-10) continue; // unknown operator
+        std::unique_ptr<FilterNode> node=createLeaf(operatorType,reference,type);
+        if(!m_root){
+            m_root=std::move(node);
+        }else{
+            std::unique_ptr<FilterNode> parent(new FilterNode);
+            parent->type= connectAnd ? FilterNode::NODE_AND : FilterNode::NODE_OR;
+            parent->left=std::move(m_root);
+            parent->right=std::move(node);
+            m_root=std::move(parent);
+        }
+        connectAnd=andOperator;
+    }
+    return m_root!=nullptr;
+}
+/*!
+ * \brief compile single term, reference is taken literally (may contain & or |)
+ * \param operatorType see determineOperator
+ * \param reference
+ * \param type column type
+ * \return false if operator is unknown
+ */
+bool FilterQuery::compileTerm(int operatorType, const QString &reference, ColumnType type)
+{
+    m_text=reference;
+    m_numeric= type==COL_INT || type==COL_FLOAT;
+    m_textTerms=false;
+    m_root.reset();
+    if(operatorType<-10) return false;
+    m_root=createLeaf(operatorType,reference,type);
+    return true;
+}
+/*!
+ * \brief create leaf node for one term
+ * \param operatorType
+ * \param reference
+ * \param type
+ * \return
+ */
+std::unique_ptr<FilterNode> FilterQuery::createLeaf(int operatorType, const QString &reference, ColumnType type)
+{
+    std::unique_ptr<FilterNode> node(new FilterNode);
+    if(operatorType>=10){
+        node->type= operatorType<12 ? FilterNode::NODE_CONTAINS : FilterNode::NODE_REGEX;
+        node->negate= operatorType==11 || operatorType==13;
+        m_textTerms=true;
+        node->text=reference;
+        if(node->type==FilterNode::NODE_REGEX){
+            node->re.setPattern(reference);
+            node->re.optimize();
+        }
+    }else{
+        node->type=FilterNode::NODE_COMPARE;
+        switch(operatorType){
+        case 2: node->op=FilterNode::OP_GT; break;
+        case 1: node->op=FilterNode::OP_GE; break;
+        case 0: node->op=FilterNode::OP_EQ; break;
+        case -1: node->op=FilterNode::OP_LE; break;
+        case -2: node->op=FilterNode::OP_LT; break;
+        default: node->op=FilterNode::OP_NE; break;
+        }
+        node->text=reference;
+        m_textTerms|=!m_numeric;
+        if(type==COL_INT){
+            bool ok;
+            node->number=ColumnStore::toLong(reference.trimmed(),ok);
+        }else{
+            node->number=reference.trimmed().toDouble();
+        }
+    }
+    return node;
+}
+/*!
+ * \brief query without valid term, i.e. all rows pass
+ * \return
+ */
+bool FilterQuery::isEmpty() const
+{
+    return m_root==nullptr;
+}
+/*!
+ * \brief comparisons use number representation of column
+ * \return
+ */
+bool FilterQuery::isNumeric() const
+{
+    return m_numeric;
+}
+
+/*!
+ * \brief query contains string predicates (contains, regex or string comparison)
+ * \return
+ */
+bool FilterQuery::hasTextTerms() const
+{
+    return m_textTerms;
+}
+
+QString FilterQuery::text() const
+{
+    return m_text;
+}
+/*!
+ * \brief canonical form of compiled query
+ * Independent of white space and number notation (e.g. ">1e3" and "> 1000" are identical),
+ * so it can be used as key for cached results.
+ * \return
+ */
+QString FilterQuery::normalized() const
+{
+    if(!m_root) return QString();
+    return (m_numeric ? "n:" : "s:")+normalizedNode(m_root.get());
+}
+
+QString FilterQuery::normalizedNode(const FilterNode *node) const
+{
+    static const char *ops[]={">",">=","=","<=","<","!="};
+    switch(node->type){
+    case FilterNode::NODE_AND:
+        return "("+normalizedNode(node->left.get())+"&"+normalizedNode(node->right.get())+")";
+    case FilterNode::NODE_OR:
+        return "("+normalizedNode(node->left.get())+"|"+normalizedNode(node->right.get())+")";
+    case FilterNode::NODE_CONTAINS:
+        return (node->negate ? "!contains " : "contains ")+node->text;
+    case FilterNode::NODE_REGEX:
+        return (node->negate ? "!regex " : "regex ")+node->text;
+    case FilterNode::NODE_COMPARE:
+        break;
+    }
+    if(m_numeric){
+        return ops[node->op]+QString::number(node->number,'g',17);
+    }
+    return ops[node->op]+node->text;
+}
+/*!
+ * \brief check if query is one numeric interval, e.g. ">=2e9 & <3e9"
+ * Only comparisons (not !=) combined with & qualify.
+ * \param low
+ * \param lowInclusive
+ * \param high
+ * \param highInclusive
+ * \return false if query can not be expressed as interval
+ */
+bool FilterQuery::numericRange(double &low, bool &lowInclusive, double &high, bool &highInclusive) const
+{
+    if(!m_numeric || !m_root) return false;
+    low=-std::numeric_limits<double>::infinity();
+    high=std::numeric_limits<double>::infinity();
+    lowInclusive=true;
+    highInclusive=true;
+    return rangeNode(m_root.get(),low,lowInclusive,high,highInclusive);
+}
+
+bool FilterQuery::rangeNode(const FilterNode *node, double &low, bool &lowInclusive, double &high, bool &highInclusive) const
+{
+    if(node->type==FilterNode::NODE_AND){
+        return rangeNode(node->left.get(),low,lowInclusive,high,highInclusive)
+                && rangeNode(node->right.get(),low,lowInclusive,high,highInclusive);
+    }
+    if(node->type!=FilterNode::NODE_COMPARE || std::isnan(node->number)) return false;
+    const double r=node->number;
+    const bool raiseLow= node->op==FilterNode::OP_GT || node->op==FilterNode::OP_GE || node->op==FilterNode::OP_EQ;
+    const bool lowerHigh= node->op==FilterNode::OP_LT || node->op==FilterNode::OP_LE || node->op==FilterNode::OP_EQ;
+    if(node->op==FilterNode::OP_NE) return false;
+    if(raiseLow){
+        const bool inclusive= node->op!=FilterNode::OP_GT;
+        if(r>low || (r==low && !inclusive)){
+            low=r;
+            lowInclusive=inclusive;
+        }
+    }
+    if(lowerHigh){
+        const bool inclusive= node->op!=FilterNode::OP_LT;
+        if(r<high || (r==high && !inclusive)){
+            high=r;
+            highInclusive=inclusive;
+        }
+    }
+    return true;
+}
+/*!
+ * \brief prepare evaluation on input
+ * With a dictionary, string predicates are evaluated once per distinct value.
+ * Needs to be called before evaluate() whenever the input column changes.
+ * \param input
+ */
+void FilterQuery::prepare(const FilterInput &input)
+{
+    if(m_root){
+        prepareNode(m_root.get(),input);
+    }
+}
+
+void FilterQuery::prepareNode(FilterNode *node, const FilterInput &input)
+{
+    if(node->type==FilterNode::NODE_AND || node->type==FilterNode::NODE_OR){
+        prepareNode(node->left.get(),input);
+        prepareNode(node->right.get(),input);
+        return;
+    }
+    node->table.clear();
+    if(!input.dictionary) return;
+    if(node->type==FilterNode::NODE_COMPARE && m_numeric) return;
+    const QStringList &values=input.dictionary->values;
+    node->table.resize(values.size());
+    for(qsizetype code=0;code<values.size();++code){
+        node->table[code]=matchText(node,values.at(code));
+    }
+}
+/*!
+ * \brief evaluate string predicate (leaf) on one cell
+ * \param node
+ * \param text
+ * \return
+ */
+bool FilterQuery::matchText(const FilterNode *node, const QString &text) const
+{
+    switch(node->type){
+    case FilterNode::NODE_CONTAINS:
+        return text.contains(node->text)!=node->negate;
+    case FilterNode::NODE_REGEX:
+        return node->re.match(text).hasMatch()!=node->negate;
+    default:
+        break;
+    }
+    const int c=text.compare(node->text);
+    switch(node->op){
+    case FilterNode::OP_GT: return c>0;
+    case FilterNode::OP_GE: return c>=0;
+    case FilterNode::OP_EQ: return c==0;
+    case FilterNode::OP_LE: return c<=0;
+    case FilterNode::OP_LT: return c<0;
+    case FilterNode::OP_NE: break;
+    }
+    return c!=0;
+}
+/*!
+ * \brief evaluate query for rows [begin,end)
+ * \param input column data
+ * \param begin multiple of 64
+ * \param end
+ * \param words bitmap with bit set for rows which pass, ceil((end-begin)/64) words
+ */
+void FilterQuery::evaluate(const FilterInput &input, qsizetype begin, qsizetype end, quint64 *words) const
+{
+    const qsizetype wordCount=RowSelection::wordsFor(end-begin);
+    if(!m_root){
+        std::fill(words,words+wordCount,~quint64(0));
+        const int rest=(end-begin)&63;
+        if(rest!=0){
+            words[wordCount-1]=(quint64(1)<<rest)-1;
+        }
+        return;
+    }
+    evaluateNode(m_root.get(),input,begin,end,words);
+}
+
+void FilterQuery::evaluateNode(const FilterNode *node, const FilterInput &input, qsizetype begin, qsizetype end, quint64 *words) const
+{
+    const qsizetype count=end-begin;
+    switch(node->type){
+    case FilterNode::NODE_AND:
+    case FilterNode::NODE_OR:
+    {
+        evaluateNode(node->left.get(),input,begin,end,words);
+        const qsizetype wordCount=RowSelection::wordsFor(count);
+        std::vector<quint64> right(wordCount);
+        evaluateNode(node->right.get(),input,begin,end,right.data());
+        if(node->type==FilterNode::NODE_AND){
+            andKernel(words,right.data(),wordCount);
+        }else{
+            orKernel(words,right.data(),wordCount);
+        }
+        break;
+    }
+    default:
+        if(node->type==FilterNode::NODE_COMPARE && m_numeric){
+            compareKernel(input.numbers+begin,count,node->op,node->number,words);
+        }else if(!node->table.empty()){
+            // gather pass over the dictionary codes
+            const quint32 *codes=input.dictionary->codes.data()+begin;
+            const quint8 *table=node->table.data();
+            packRange(count,words,[codes,table](qsizetype i){return table[codes[i]];});
+        }else{
+            const QStringList &cells=*input.cells;
+            packRange(count,words,[&](qsizetype i){return matchText(node,cells.at(begin+i));});
+        }
+        break;
+    }
+}
+/*!
+ * \brief detremine operator and the corresponding reference
+ * e.g. ">=0" -> ">="=2 , "0"
+ * \param text
+ * \param reference
+ * \return opType (2 >,1 >=,0 =,-1 <=, -2 <,-3 !=, -1000 uknown, 10 contains,11 !contains,12 regex,13 !regex)
+ */
+int FilterQuery::determineOperator(const QString &text, QString &reference)
+{
+    if(text.startsWith(">=")){
+        reference=text.mid(2);
+        return 1;
+    }
+    if(text.startsWith("<=")){
+        reference=text.mid(2);
+        return -1;
+    }
+    if(text.startsWith("!=")){
+        reference=text.mid(2);
+        return -3;
+    }
+    if(text.startsWith('>')){
+        reference=text.mid(1);
+        return 2;
+    }
+    if(text.startsWith('<')){
+        reference=text.mid(1);
+        return -2;
+    }
+    if(text.startsWith('=')){
+        reference=text.mid(1);
+        return 0;
+    }
+    if(text.startsWith("contains ")){
+        reference=text.mid(9);
+        return 10;
+    }
+    if(text.startsWith("!contains ")){
+        reference=text.mid(10);
+        return 11;
+    }
+    if(text.startsWith("regex ")){
+        reference=text.mid(6);
+        return 12;
+    }
+    if(text.startsWith("!regex ")){
+        reference=text.mid(7);
+        return 13;
+    }
+    return -1000; // unknown
+}
@@ -0,0 +1,78 @@
+#ifndef FILTERQUERY_H
+#define FILTERQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QRegularExpression>
+#include <memory>
+#include <vector>
+
+#include "columnstore.h"
+
+/*!
+ * \brief node of compiled filter query
+ * Leaves hold the pre-parsed reference (number, text or regex),
+ * inner nodes combine their two children with and/or.
+ */
+struct FilterNode{
+    enum Type {NODE_AND,NODE_OR,NODE_COMPARE,NODE_CONTAINS,NODE_REGEX};
+    enum Op {OP_GT,OP_GE,OP_EQ,OP_LE,OP_LT,OP_NE};
+
+    Type type=NODE_COMPARE;
+    Op op=OP_EQ;
+    bool negate=false;
+    QString text;
+    double number=0;
+    QRegularExpression re;
+    std::vector<quint8> table; // pass per dictionary code, filled by FilterQuery::prepare
+    std::unique_ptr<FilterNode> left,right;
+};
+
+/*!
+ * \brief data of one column as needed for evaluation
+ */
+struct FilterInput{
+    const QStringList *cells=nullptr;
+    const double *numbers=nullptr; // only needed for numeric columns
+    const ColumnDictionary *dictionary=nullptr; // optional, string predicates are then evaluated per distinct value
+};
+
+/*!
+ * \brief column filter query compiled once into a predicate tree
+ * Query syntax: terms (>,>=,<,<=,=,!=,contains,!contains,regex,!regex) connected by & and |,
+ * evaluated from left to right.
+ */
+class FilterQuery
+{
+public:
+    FilterQuery();
+
+    bool compile(const QString &text,ColumnType type);
+    bool compileTerm(int operatorType,const QString &reference,ColumnType type);
+    bool isEmpty() const;
+    bool isNumeric() const;
+    bool hasTextTerms() const;
+    QString text() const;
+    QString normalized() const;
+    bool numericRange(double &low,bool &lowInclusive,double &high,bool &highInclusive) const;
+
+    void prepare(const FilterInput &input);
+    void evaluate(const FilterInput &input,qsizetype begin,qsizetype end,quint64 *words) const;
+
+    static int determineOperator(const QString &text,QString &reference);
+
+private:
+    std::unique_ptr<FilterNode> createLeaf(int operatorType,const QString &reference,ColumnType type);
+    void prepareNode(FilterNode *node,const FilterInput &input);
+    QString normalizedNode(const FilterNode *node) const;
+    bool rangeNode(const FilterNode *node,double &low,bool &lowInclusive,double &high,bool &highInclusive) const;
+    bool matchText(const FilterNode *node,const QString &text) const;
+    void evaluateNode(const FilterNode *node,const FilterInput &input,qsizetype begin,qsizetype end,quint64 *words) const;
+
+    QString m_text;
+    bool m_numeric;
+    bool m_textTerms;
+    std::unique_ptr<FilterNode> m_root;
+};
+
+#endif // FILTERQUERY_H
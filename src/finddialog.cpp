@@ -0,0 +1,320 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "finddialog.h"
+
+#include <QLineEdit>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QListWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QRegularExpression>
+#include <QThread>
+#include <cmath>
+#include <limits>
+
+#include "parallel.h"
+
+static const int maxHits=100000;
+static const qsizetype findBlockSize=1<<16;
+
+/*!
+ * \brief precompiled search condition
+ * Created once per search and shared read-only by all threads.
+ */
+struct FindMatcher{
+    FindDialog::Mode mode=FindDialog::FIND_TEXT;
+    QString text;
+    Qt::CaseSensitivity cs=Qt::CaseInsensitive;
+    QRegularExpression re;
+    bool numeric=false;
+    double low=0;
+    double high=0;
+};
+
+struct FindTask{
+    int column;
+    bool numeric;
+    const QStringList *cells;
+    const double *numbers;
+};
+/*!
+ * \brief interpret text as numeric range
+ * "a..b", "..b", "a.." or single number "a"
+ * \param text
+ * \param low
+ * \param high
+ * \return success
+ */
+static bool parseRange(const QString &text,double &low,double &high)
+{
+    bool ok=true;
+    int pos=text.indexOf("..");
+    if(pos<0){
+        low=text.trimmed().toDouble(&ok);
+        high=low;
+        return ok;
+    }
+    QString lowText=text.left(pos).trimmed();
+    QString highText=text.mid(pos+2).trimmed();
+    low=-std::numeric_limits<double>::infinity();
+    high=std::numeric_limits<double>::infinity();
+    if(!lowText.isEmpty()){
+        low=lowText.toDouble(&ok);
+        if(!ok) return false;
+    }
+    if(!highText.isEmpty()){
+        high=highText.toDouble(&ok);
+        if(!ok) return false;
+    }
+    return !lowText.isEmpty() || !highText.isEmpty();
+}
+
+FindDialog::FindDialog(QWidget *parent)
+    : QDialog(parent),m_columns(nullptr),m_data(nullptr),m_store(nullptr),m_thread(nullptr),m_hitCount(0),m_searchId(0)
+{
+    setWindowTitle(tr("Find"));
+    setModal(false);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    QHBoxLayout *hLayout = new QHBoxLayout;
+    leText = new QLineEdit;
+    connect(leText,&QLineEdit::returnPressed,this,&FindDialog::startSearch);
+    hLayout->addWidget(leText,1);
+    cbMode = new QComboBox;
+    cbMode->addItem(tr("text"),FIND_TEXT);
+    cbMode->addItem(tr("regex"),FIND_REGEX);
+    cbMode->addItem(tr("numeric range (a..b)"),FIND_RANGE);
+    hLayout->addWidget(cbMode);
+    QPushButton *btFind = new QPushButton(tr("Find"));
+    btFind->setDefault(true);
+    connect(btFind,&QPushButton::clicked,this,&FindDialog::startSearch);
+    hLayout->addWidget(btFind);
+    mainLayout->addLayout(hLayout);
+    QHBoxLayout *hLayout2 = new QHBoxLayout;
+    chkCaseSensitive = new QCheckBox(tr("case sensitive"));
+    hLayout2->addWidget(chkCaseSensitive);
+    chkSelectedColumns = new QCheckBox(tr("selected columns only"));
+    hLayout2->addWidget(chkSelectedColumns);
+    hLayout2->addStretch(1);
+    mainLayout->addLayout(hLayout2);
+    lstResults = new QListWidget;
+    connect(lstResults,&QListWidget::currentItemChanged,this,&FindDialog::currentHitChanged);
+    connect(lstResults,&QListWidget::itemActivated,this,&FindDialog::currentHitChanged);
+    mainLayout->addWidget(lstResults,1);
+    lblStatus = new QLabel;
+    mainLayout->addWidget(lblStatus);
+    setLayout(mainLayout);
+    resize(500,400);
+}
+
+FindDialog::~FindDialog()
+{
+    stopSearch();
+}
+/*!
+ * \brief set data to search in
+ * A running search is stopped.
+ * \param columns
+ * \param data
+ * \param store
+ */
+void FindDialog::setSource(const QStringList *columns, const QVector<QStringList> *data, ColumnStore *store)
+{
+    stopSearch();
+    m_columns=columns;
+    m_data=data;
+    m_store=store;
+    lstResults->clear();
+    lblStatus->clear();
+}
+/*!
+ * \brief set columns which are searched if "selected columns only" is checked
+ * \param columns
+ */
+void FindDialog::setSelectedColumns(const QList<int> &columns)
+{
+    m_selectedColumns=columns;
+}
+/*!
+ * \brief cancel running search and wait for it to end
+ */
+void FindDialog::stopSearch()
+{
+    if(!m_thread) return;
+    *m_cancel=true;
+    m_thread->wait();
+    delete m_thread;
+    m_thread=nullptr;
+}
+/*!
+ * \brief start search in background
+ * Ranges are searched on the number representation of numeric columns, text and regex on the cell text.
+ */
+void FindDialog::startSearch()
+{
+    stopSearch();
+    lstResults->clear();
+    m_hitCount=0;
+    const int searchId=++m_searchId; // results of previous searches are ignored
+    if(!m_data || m_data->isEmpty()) return;
+    const QString text=leText->text();
+    if(text.isEmpty()) return;
+
+    FindMatcher matcher;
+    matcher.mode=static_cast<Mode>(cbMode->currentData().toInt());
+    matcher.text=text;
+    matcher.cs=chkCaseSensitive->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    switch(matcher.mode){
+    case FIND_REGEX:
+        matcher.re.setPattern(text);
+        if(!chkCaseSensitive->isChecked()){
+            matcher.re.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+        }
+        if(!matcher.re.isValid()){
+            lblStatus->setText(tr("invalid regex: %1").arg(matcher.re.errorString()));
+            return;
+        }
+        matcher.re.optimize();
+        break;
+    case FIND_RANGE:
+        if(!parseRange(text,matcher.low,matcher.high)){
+            lblStatus->setText(tr("use a..b, ..b, a.. or a"));
+            return;
+        }
+        matcher.numeric=true;
+        break;
+    case FIND_TEXT:
+        break; // substring of cell text, also for numbers (e.g. serial numbers beyond double precision)
+    }
+
+    QList<int> columns;
+    if(chkSelectedColumns->isChecked() && !m_selectedColumns.isEmpty()){
+        columns=m_selectedColumns;
+    }else{
+        for(int i=0;i<m_data->size();++i){
+            columns<<i;
+        }
+    }
+    // prepare typed data in GUI thread, search threads only read
+    QVector<FindTask> tasks;
+    for(int column:columns){
+        if(column<0 || column>=m_data->size()) continue;
+        ColumnType type=m_store->type(column);
+        bool numericColumn=type==COL_INT || type==COL_FLOAT;
+        FindTask task{column,false,&m_data->at(column),nullptr};
+        if(matcher.numeric && numericColumn){
+            task.numeric=true;
+            task.numbers=m_store->numbers(column).data();
+        }else{
+            if(matcher.mode==FIND_RANGE) continue; // range only on numbers
+        }
+        tasks<<task;
+    }
+    const qsizetype rows=m_data->first().size();
+    const qsizetype blocksPerColumn=(rows+findBlockSize-1)/findBlockSize;
+    if(tasks.isEmpty() || blocksPerColumn==0){
+        lblStatus->setText(tr("nothing to search"));
+        return;
+    }
+
+    lblStatus->setText(tr("searching ..."));
+    m_cancel=std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<bool>> cancel=m_cancel;
+    m_thread=QThread::create([this,searchId,tasks,matcher,cancel,rows,blocksPerColumn](){
+        std::atomic<int> hitCount{0};
+        parallelFor(tasks.size()*blocksPerColumn,1,[&](qsizetype item,qsizetype){
+            if(*cancel) return;
+            const FindTask &task=tasks.at(item/blocksPerColumn);
+            const qsizetype begin=(item%blocksPerColumn)*findBlockSize;
+            const qsizetype end=qMin(rows,begin+findBlockSize);
+            QVector<FindHit> hits;
+            if(task.numeric){
+                for(qsizetype i=begin;i<end;++i){
+                    const double v=task.numbers[i];
+                    if(v>=matcher.low && v<=matcher.high){
+                        hits.append(FindHit{static_cast<int>(i),task.column});
+                    }
+                }
+            }else{
+                const QStringList &cells=*task.cells;
+                if(matcher.mode==FIND_REGEX){
+                    for(qsizetype i=begin;i<end;++i){
+                        if(matcher.re.match(cells.at(i)).hasMatch()){
+                            hits.append(FindHit{static_cast<int>(i),task.column});
+                        }
+                    }
+                }else{
+                    for(qsizetype i=begin;i<end;++i){
+                        if(cells.at(i).contains(matcher.text,matcher.cs)){
+                            hits.append(FindHit{static_cast<int>(i),task.column});
+                        }
+                    }
+                }
+            }
+            if(hits.isEmpty()) return;
+            if(hitCount.fetch_add(hits.size())+hits.size()>=maxHits){
+                *cancel=true;
+            }
+            QMetaObject::invokeMethod(this,[this,searchId,hits](){
+                if(searchId==m_searchId){
+                    addHits(hits);
+                }
+            },Qt::QueuedConnection);
+        });
+        const bool canceled=*cancel;
+        QMetaObject::invokeMethod(this,[this,searchId,canceled](){
+            if(searchId==m_searchId){
+                searchFinished(canceled);
+            }
+        },Qt::QueuedConnection);
+    });
+    m_thread->start();
+}
+/*!
+ * \brief add hits to result list
+ * \param hits
+ */
+void FindDialog::addHits(const QVector<FindHit> &hits)
+{
+    if(!m_data) return;
+    lstResults->setUpdatesEnabled(false);
+    for(const FindHit &hit:hits){
+        if(m_hitCount>=maxHits) break;
+        QString text=QString("%1 [%2]: %3").arg(m_columns->value(hit.column)).arg(hit.row+1).arg(m_data->at(hit.column).value(hit.row));
+        QListWidgetItem *item=new QListWidgetItem(text,lstResults);
+        item->setData(Qt::UserRole,hit.row);
+        item->setData(Qt::UserRole+1,hit.column);
+        ++m_hitCount;
+    }
+    lstResults->setUpdatesEnabled(true);
+    lblStatus->setText(tr("%1 hits, searching ...").arg(m_hitCount));
+}
+/*!
+ * \brief update status after search
+ * \param canceled
+ */
+void FindDialog::searchFinished(bool canceled)
+{
+    if(canceled && m_hitCount>=maxHits){
+        lblStatus->setText(tr("more than %1 hits, search stopped").arg(maxHits));
+    }else{
+        lblStatus->setText(tr("%1 hits").arg(m_hitCount));
+    }
+}
+/*!
+ * \brief jump to selected hit
+ * \param item
+ */
+void FindDialog::currentHitChanged(QListWidgetItem *item)
+{
+    if(!item) return;
+    emit hitActivated(item->data(Qt::UserRole).toInt(),item->data(Qt::UserRole+1).toInt());
+}
@@ -0,0 +1,70 @@
+#ifndef FINDDIALOG_H
+#define FINDDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+
+#include "columnstore.h"
+
+class QLineEdit;
+class QComboBox;
+class QCheckBox;
+class QListWidget;
+class QListWidgetItem;
+class QLabel;
+class QThread;
+
+struct FindHit{
+    int row;
+    int column;
+};
+
+/*!
+ * \brief non-modal find dialog
+ * Searches the column data in parallel blocks in a background thread.
+ * Hits are streamed to the result list while the search is running.
+ */
+class FindDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    enum Mode {FIND_TEXT,FIND_REGEX,FIND_RANGE};
+
+    FindDialog(QWidget *parent = nullptr);
+    ~FindDialog();
+
+    void setSource(const QStringList *columns,const QVector<QStringList> *data,ColumnStore *store);
+    void setSelectedColumns(const QList<int> &columns);
+    void stopSearch();
+
+signals:
+    void hitActivated(int row,int column);
+
+protected:
+    void startSearch();
+    void addHits(const QVector<FindHit> &hits);
+    void searchFinished(bool canceled);
+    void currentHitChanged(QListWidgetItem *item);
+
+private:
+    QLineEdit *leText;
+    QComboBox *cbMode;
+    QCheckBox *chkCaseSensitive,*chkSelectedColumns;
+    QListWidget *lstResults;
+    QLabel *lblStatus;
+
+    const QStringList *m_columns;
+    const QVector<QStringList> *m_data;
+    ColumnStore *m_store;
+    QList<int> m_selectedColumns;
+
+    QThread *m_thread;
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+    int m_hitCount;
+    int m_searchId;
+};
+
+#endif // FINDDIALOG_H
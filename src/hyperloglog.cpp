@@ -0,0 +1,83 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "hyperloglog.h"
+
+#include <QHash>
+#include <cmath>
+
+HyperLogLog::HyperLogLog():m_registers(std::size_t(1)<<indexBits,0)
+{
+}
+/*!
+ * \brief add value by its 64 bit hash
+ * Upper bits select the register, the register keeps the longest run of leading zeros of the rest.
+ * \param hash
+ */
+void HyperLogLog::add(quint64 hash)
+{
+    const quint64 index=hash>>(64-indexBits);
+    const quint64 rest=(hash<<indexBits)|(quint64(1)<<(indexBits-1)); // guard bit limits the rank
+    const quint8 rank=quint8(qCountLeadingZeroBits(rest)+1);
+    if(rank>m_registers[index]){
+        m_registers[index]=rank;
+    }
+}
+
+void HyperLogLog::add(const QString &value)
+{
+    add(hash(value));
+}
+/*!
+ * \brief combine with sketch of other values
+ * Result estimates the distinct values of both.
+ * \param other
+ */
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+    for(std::size_t i=0;i<m_registers.size();++i){
+        if(other.m_registers[i]>m_registers[i]){
+            m_registers[i]=other.m_registers[i];
+        }
+    }
+}
+/*!
+ * \brief estimated number of distinct values
+ * Uses linear counting for small cardinalities.
+ * \return
+ */
+double HyperLogLog::estimate() const
+{
+    const double m=double(m_registers.size());
+    double sum=0;
+    int zeros=0;
+    for(quint8 reg:m_registers){
+        sum+=std::ldexp(1.0,-reg);
+        if(reg==0) ++zeros;
+    }
+    const double alpha=0.7213/(1+1.079/m);
+    const double estimate=alpha*m*m/sum;
+    if(estimate<=2.5*m && zeros>0){
+        return m*std::log(m/zeros);
+    }
+    return estimate;
+}
+/*!
+ * \brief 64 bit hash of string
+ * qHash is mixed (splitmix64 finalizer) so that all bits are usable.
+ * \param value
+ * \return
+ */
+quint64 HyperLogLog::hash(const QString &value)
+{
+    quint64 h=quint64(qHash(value));
+    h+=0x9e3779b97f4a7c15ULL;
+    h=(h^(h>>30))*0xbf58476d1ce4e5b9ULL;
+    h=(h^(h>>27))*0x94d049bb133111ebULL;
+    return h^(h>>31);
+}
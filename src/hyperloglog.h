@@ -0,0 +1,30 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <QtGlobal>
+#include <QString>
+#include <vector>
+
+/*!
+ * \brief HyperLogLog sketch for estimating the number of distinct values
+ * 2^12 registers (4 KiB), standard error about 1.6%.
+ * Sketches of parts of a column can be merged.
+ */
+class HyperLogLog
+{
+public:
+    HyperLogLog();
+
+    void add(quint64 hash);
+    void add(const QString &value);
+    void merge(const HyperLogLog &other);
+    double estimate() const;
+
+    static quint64 hash(const QString &value);
+
+private:
+    static const int indexBits=12;
+    std::vector<quint8> m_registers;
+};
+
+#endif // HYPERLOGLOG_H
@@ -14,22 +14,45 @@
 #include <QtCharts>
 #include <QtGlobal>
 #include <QSettings>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QWidgetAction>
+#include <QApplication>
 #include <set>
+#include <map>
+#include <algorithm>
 #include "zoomablechart.h"
-
-/*!
- * \brief Max
- * \param a
- * \param b
+#include "filterkernels.h"
+#include "rowgrouping.h"
+#include "parallel.h"
+#include "valuepicker.h"
+
+static const int maxAutoResizeColumns=1000; // wider tables keep default column width
+static const qint64 copyToFileThreshold=1000000; // cells, offer file export for larger selections
+static const qsizetype copyChunkSize=1<<22; // bytes written at once on file export
+static const qsizetype filterBlockSize=1<<15; // rows evaluated at once by one thread, multiple of 64, numbers fit into L2 cache
+static const int defaultFilterCacheBudget=256; // MiB
+static const int defaultMaxSeries=500; // series per plot before asking
+static const int groupingSeriesFactor=100; // estimates above limit times this ask before grouping
+
+/*!
+ * \brief first group of each span of groups which are plotted as one
+ * \param lits groups of rows
+ * \param byBand consecutive groups of one band form a span, otherwise each group
  * \return
  */
-template <typename T>
-int compare (T const& a, T const& b) {
-    int result=0;
-    if(a>b) result=1;
-    if(a<b) result=-1;
-    return result;
+static std::vector<int> groupSpans(const QList<LoopIteration> &lits,bool byBand)
+{
+    std::vector<int> starts;
+    for(int i=0;i<lits.size();++i){
+        if(!byBand || i==0 || lits.at(i).bandValues!=lits.at(i-1).bandValues){
+            starts.push_back(i);
+        }
+    }
+    return starts;
 }
+
 /*!
  * \brief construct GUI
  * Read in settings, build menu&GUI
@@ -39,12 +62,15 @@ int compare (T const& a, T const& b) {
  * \param parent
  */
 MainWindow::MainWindow(int argc, char *argv[], QWidget *parent)
-    : QMainWindow(parent),m_logx(false),m_logy(false)
+    : QMainWindow(parent),m_findDialog(nullptr),m_filterEditor(nullptr),m_sortX(false),m_selectedCells(0),m_logx(false),m_logy(false)
 {
     QSettings settings("DataExplorer","DataExplorer");
     m_recentFiles=settings.value("recentFiles").toStringList();
     m_recentTemplates=settings.value("recentTemplates").toStringList();
     m_chartTheme=static_cast<QChart::ChartTheme>(settings.value("chartTheme",QChart::ChartThemeLight).toInt());
+    m_filterCache.setBudget(qint64(settings.value("filterCacheBudget",defaultFilterCacheBudget).toInt())*1024*1024);
+    setMaxThreads(settings.value("maxThreads",0).toInt());
+    m_maxSeries=settings.value("maxSeries",defaultMaxSeries).toInt();
     setupMenus();
     setupGUI();
 
@@ -74,6 +100,9 @@ void MainWindow::closeEvent(QCloseEvent *event)
     settings.setValue("recentFiles",m_recentFiles);
     settings.setValue("recentTemplates",m_recentTemplates);
     settings.setValue("chartTheme",m_chartTheme);
+    settings.setValue("filterCacheBudget",int(m_filterCache.budget()/(1024*1024)));
+    settings.setValue("maxThreads",threadLimit());
+    settings.setValue("maxSeries",m_maxSeries);
     event->accept();
 }
 
@@ -131,6 +160,23 @@ void MainWindow::setupMenus()
     m_editMenu->addAction(copyHAction);
     copyHAction->setShortcut(Qt::Key_C);
 
+    QAction *findAction=new QAction(tr("Find..."),this);
+    connect(findAction, &QAction::triggered, this, &MainWindow::find);
+    m_editMenu->addAction(findAction);
+    findAction->setShortcut(QKeySequence::Find);
+
+    QAction *filterCacheAction=new QAction(tr("Filter cache..."),this);
+    connect(filterCacheAction, &QAction::triggered, this, &MainWindow::filterCacheSettings);
+    m_editMenu->addAction(filterCacheAction);
+
+    QAction *threadsAction=new QAction(tr("Threads..."),this);
+    connect(threadsAction, &QAction::triggered, this, &MainWindow::threadSettings);
+    m_editMenu->addAction(threadsAction);
+
+    QAction *seriesLimitAction=new QAction(tr("Series limit..."),this);
+    connect(seriesLimitAction, &QAction::triggered, this, &MainWindow::seriesLimitSettings);
+    m_editMenu->addAction(seriesLimitAction);
+
     QToolBar *plotToolBar = addToolBar(tr("Plot"));
     m_plotMenu = menuBar()->addMenu(tr("&Plot"));
     m_plotAct = new QAction(tr("&Plot"), this);
@@ -279,16 +325,54 @@ void MainWindow::setupMenus()
     connect(act,&QAction::triggered,this,&MainWindow::plotStyleChanged);
     m_plotTypeMenu->addAction(act);
     m_plotTypeActionGroup->addAction(act);
-    m_lineSeriesAveragedAct=new QAction(tr("line series averaged"),this);
-    m_lineSeriesAveragedAct->setCheckable(true);
-    connect(m_lineSeriesAveragedAct,&QAction::triggered,this,&MainWindow::plotStyleChanged);
-    m_plotTypeActionGroup->addAction(m_lineSeriesAveragedAct);
-    m_plotTypeMenu->addAction(m_lineSeriesAveragedAct);
     m_plotMenu->addMenu(m_plotTypeMenu);
 
+    m_aggregationMenu=new QMenu(tr("aggregate y per x"));
+    QActionGroup *aggregationGroup=new QActionGroup(this);
+    aggregationGroup->setExclusive(true);
+    const QStringList aggregationNames={tr("none"),tr("mean"),tr("median"),tr("min"),tr("max"),tr("std"),tr("count"),tr("sum"),tr("percentile...")};
+    for(int type=AggregationSpec::AGG_NONE;type<=AggregationSpec::AGG_PERCENTILE;++type){
+        act=new QAction(aggregationNames.at(type),this);
+        act->setCheckable(true);
+        act->setChecked(type==AggregationSpec::AGG_NONE);
+        act->setData(type);
+        connect(act,&QAction::triggered,this,&MainWindow::aggregationChanged);
+        aggregationGroup->addAction(act);
+        m_aggregationMenu->addAction(act);
+    }
+    m_plotMenu->addMenu(m_aggregationMenu);
+
+    act=new QAction(tr("sort by x"),this);
+    act->setCheckable(true);
+    act->setChecked(m_sortX);
+    connect(act,&QAction::toggled,this,&MainWindow::sortXChanged);
+    m_plotMenu->addAction(act);
+
+    m_envelopeMenu=new QMenu(tr("band across last sweep var"));
+    QActionGroup *envelopeGroup=new QActionGroup(this);
+    envelopeGroup->setExclusive(true);
+    const QStringList envelopeNames={tr("none"),tr("min/max"),tr("mean +- k sigma...")};
+    for(int type=EnvelopeSpec::ENV_NONE;type<=EnvelopeSpec::ENV_SIGMA;++type){
+        act=new QAction(envelopeNames.at(type),this);
+        act->setCheckable(true);
+        act->setChecked(type==EnvelopeSpec::ENV_NONE);
+        act->setData(type);
+        connect(act,&QAction::triggered,this,&MainWindow::envelopeChanged);
+        envelopeGroup->addAction(act);
+        m_envelopeMenu->addAction(act);
+    }
+    m_plotMenu->addMenu(m_envelopeMenu);
+
+    act=new QAction(tr("pivot table from sweeps"),this);
+    connect(act,&QAction::triggered,this,&MainWindow::pivotFromSweeps);
+    m_plotMenu->addAction(act);
+
     QAction *testAction=new QAction("test",this);
     connect(testAction, &QAction::triggered, this, &MainWindow::test);
     m_plotMenu->addAction(testAction);
+    QAction *benchmarkAction=new QAction(tr("benchmark filter"),this);
+    connect(benchmarkAction, &QAction::triggered, this, &MainWindow::benchmarkFilter);
+    m_plotMenu->addAction(benchmarkAction);
 
     QMenu *helpMenu = menuBar()->addMenu(tr("&Help"));
     act=new QAction(tr("About"),this);
@@ -300,7 +384,10 @@ void MainWindow::setupMenus()
  */
 void MainWindow::setupGUI()
 {
-    tableWidget = new QTableWidget;
+    tableView = new QTableView;
+    m_model = new CsvTableModel(this);
+    m_model->setSource(&m_columns,&m_csv,&m_store);
+    tableView->setModel(m_model);
     QWidget *wgt= new QWidget;
     QVBoxLayout *mainLayout = new QVBoxLayout;
     QHBoxLayout *hLayout = new QHBoxLayout;
@@ -310,6 +397,8 @@ void MainWindow::setupGUI()
     lstSweeps->setDefaultDropAction(Qt::MoveAction);
     lstSweeps->setAcceptDrops(true);
     lstSweeps->setDropIndicatorShown(true);
+    lstSweeps->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(lstSweeps,&QWidget::customContextMenuRequested,this,&MainWindow::sweepMenuRequested);
     lstData = new QListWidget;
     lstData->setDragEnabled(true);
     lstData->setDefaultDropAction(Qt::MoveAction);
@@ -342,6 +431,10 @@ void MainWindow::setupGUI()
     hLayout2->addWidget(btFilter);
     leFilterText = new QLineEdit;
     connect(leFilterText,&QLineEdit::textEdited,this,&MainWindow::filterTextChanged);
+    m_filterTimer=new QTimer(this);
+    m_filterTimer->setSingleShot(true);
+    m_filterTimer->setInterval(150);
+    connect(m_filterTimer,&QTimer::timeout,this,&MainWindow::applyColumnNameFilter);
     hLayout2->addWidget(leFilterText);
     btRegExp=new QToolButton;
     btRegExp->setCheckable(true);
@@ -351,7 +444,12 @@ void MainWindow::setupGUI()
     hLayout2->addWidget(btRegExp);
     hLayout2->addSpacing(1);
     mainLayout->addLayout(hLayout2);
-    mainLayout->addWidget(tableWidget,3);
+    leQuery = new QLineEdit;
+    leQuery->setPlaceholderText(tr("Query, e.g. (temp > 85 | vdd < 0.9) & corner != \"ff\" & freq >= 1e9"));
+    leQuery->setClearButtonEnabled(true);
+    connect(leQuery,&QLineEdit::returnPressed,this,&MainWindow::applyQuery);
+    mainLayout->addWidget(leQuery);
+    mainLayout->addWidget(tableView,3);
     wgt->setLayout(mainLayout);
 
     chartView = new ZoomableChartView();
@@ -364,10 +462,18 @@ void MainWindow::setupGUI()
     tabWidget = new QTabWidget;
     tabWidget->addTab(wgt,tr("CSV"));
     tabWidget->addTab(chartView,tr("Plots"));
+    pivotView = new PivotView;
+    pivotView->setSource(&m_csv,&m_store,&m_columns);
+    tabWidget->addTab(pivotView,tr("Pivot"));
     connect(tabWidget,&QTabWidget::currentChanged,this,&MainWindow::tabChanged);
 
-    tableWidget->horizontalHeader()-> setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(tableWidget->horizontalHeader(),&QAbstractItemView::customContextMenuRequested,this,&MainWindow::headerMenuRequested);
+    connect(tableView->selectionModel(),&QItemSelectionModel::selectionChanged,this,&MainWindow::tableSelectionChanged);
+    connect(m_model,&QAbstractItemModel::modelReset,this,&MainWindow::resetSelectionStats);
+    lblSelectionStats=new QLabel;
+    statusBar()->addPermanentWidget(lblSelectionStats);
+
+    tableView->horizontalHeader()-> setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(tableView->horizontalHeader(),&QAbstractItemView::customContextMenuRequested,this,&MainWindow::headerMenuRequested);
 
     setCentralWidget(tabWidget);
     this->setMouseTracking(true);
@@ -396,8 +502,9 @@ void MainWindow::reloadFile()
     const auto store_plotValues=m_plotValues;
     readFile();
     m_columnFilters=store_columnFilters;
-    for(const ColumnFilter &cf:m_columnFilters){
+    for(ColumnFilter &cf:m_columnFilters){
         const int column=cf.column;
+        compileColumnFilter(cf); // column type may have changed
         updateColBackground(column,true);
     }
     updateFilteredTable();
@@ -439,6 +546,12 @@ void MainWindow::openRecentTemplate()
 void MainWindow::readFile()
 {
     if(m_fileName.isEmpty()) return;
+    if(m_findDialog){
+        m_findDialog->stopSearch(); // search must not run while data is replaced
+    }
+    if(m_filterEditor){
+        m_filterEditor->stopEvaluation();
+    }
     bool ok;
     if(m_fileName.endsWith(".s2p")){
         ok=readInSNP(m_fileName,2);
@@ -455,6 +568,13 @@ void MainWindow::readFile()
     }
     if(!ok) return;
     buildTable();
+    if(m_findDialog){
+        m_findDialog->setSource(&m_columns,&m_csv,&m_store);
+    }
+    if(m_filterEditor){
+        m_filterEditor->setSource(&m_csv,&m_store);
+        m_filterEditor->hide();
+    }
     m_sweeps.clear();
     m_plotValues.clear();
     if(m_columns.size()==2){
@@ -462,11 +582,11 @@ void MainWindow::readFile()
         m_sweeps<<m_columns[0];
         m_plotValues<<m_columns[1];
     }else{
-        if(m_columns.contains("x")){
+        if(m_columnIndex.contains("x")){
             // add x to sweeps
             m_sweeps<<"x";
         }
-        if(m_columns.contains("y")){
+        if(m_columnIndex.contains("y")){
             // add y to plot values
             m_plotValues<<"y";
         }
@@ -515,6 +635,17 @@ void MainWindow::saveTemplate()
         jFilters.append(jCF);
     }
     jo["filters"]=jFilters;
+    jo["query"]=leQuery->text();
+    // binning of sweep vars
+    QJsonObject jBinning;
+    for(auto it=m_binning.constBegin();it!=m_binning.constEnd();++it){
+        if(!it.value().isActive()) continue;
+        QJsonObject jBin;
+        jBin["mode"]=int(it.value().mode);
+        jBin["parameter"]=it.value().parameter;
+        jBinning[it.key()]=jBin;
+    }
+    jo["binning"]=jBinning;
 
     QJsonDocument saveDoc(jo);
     saveFile.write(saveDoc.toJson());
@@ -552,6 +683,17 @@ void MainWindow::readTemplate(const QString &fileName)
     for(int i = 0; i < ja.size(); ++i) {
         m_plotValues<<ja[i].toString();
     }
+    m_binning.clear();
+    const QJsonObject jBinning=jo["binning"].toObject();
+    for(auto it=jBinning.constBegin();it!=jBinning.constEnd();++it){
+        const QJsonObject jBin=it.value().toObject();
+        BinSpec spec;
+        const int mode=jBin["mode"].toInt();
+        if(mode<BinSpec::BIN_NONE || mode>BinSpec::BIN_TOLERANCE) continue;
+        spec.mode=static_cast<BinSpec::Mode>(mode);
+        spec.parameter=jBin["parameter"].toDouble();
+        m_binning.insert(it.key(),spec);
+    }
     // handle filters
     // reset old filter
     for(const ColumnFilter &cf:m_columnFilters){
@@ -566,22 +708,21 @@ void MainWindow::readTemplate(const QString &fileName)
         QString columnName=jCF["name"].toString();
         cf.column=getIndex(columnName);
         if(cf.column<0) continue; // name not present in current data
-        std::vector<bool> providedIndices(m_csv[0].size());
-        for(int i=0;i<m_csv[0].size();++i){
-            providedIndices[i]=true;
-        }
-        QStringList presentValues=getUniqueValues(columnName,providedIndices);
-        presentValues.sort();
+        const QStringList &distinct=m_store.distinctValues(cf.column);
+        const QSet<QString> presentValues(distinct.constBegin(),distinct.constEnd());
         QJsonArray jValues=jCF["values"].toArray();
         for(int k=0;k<jValues.size();++k){
             QString val=jValues[k].toString();
-            if(std::binary_search(presentValues.constBegin(),presentValues.constEnd(),val)){
+            if(presentValues.contains(val)){
                 cf.allowedValues<<val;
             }
         }
         m_columnFilters.append(cf);
         updateColBackground(cf.column,true);
     }
+    leQuery->setText(jo["query"].toString());
+    m_queryResult.reset();
+    compileQuery();
     updateSweepGUI();
     updateFilteredTable();
 }
@@ -659,7 +800,7 @@ bool MainWindow::readInCSV(const QString &fileName)
             return false;
         }
         m_csv=data;
-        m_columnType=QVector<ColumnType>(data.size(),COL_UNKNOWN);
+        m_store.setData(&m_csv);
         m_columnFilters.clear();
         return true;
     }
@@ -731,35 +872,40 @@ bool MainWindow::readInSNP(const QString &fileName,int nrPorts)
             return false;
         }
         m_csv=data;
-        m_columnType=QVector<ColumnType>(data.size(),COL_FLOAT); // assuming normal SP-file
+        m_store.setData(&m_csv,COL_FLOAT); // assuming normal SP-file
         m_columnFilters.clear();
         return true;
     }
     return false;
 }
 /*!
- * \brief popalte table widget with present data
+ * \brief popalte table view with present data
+ * The model serves the cells and headers on demand.
  */
 void MainWindow::buildTable()
 {
-    tableWidget->clear();
+    // name lookup, first column wins on duplicate names
+    m_columnIndex.clear();
+    m_columnIndex.reserve(m_columns.size());
+    for(int i=m_columns.size()-1;i>=0;--i){
+        m_columnIndex.insert(m_columns.at(i),i);
+    }
+    m_model->setSource(&m_columns,&m_csv,&m_store);
+    pivotView->setSource(&m_csv,&m_store,&m_columns);
+    m_visibleRows=RowSelection();
+    m_filterCache.clear(); // keys of old data can not hit anymore
+    m_queryResult.reset();
+    compileQuery(); // query bar is kept for the new data
     if(m_csv.isEmpty()) return;
-    tableWidget->setRowCount(m_csv[0].size());
-    tableWidget->setColumnCount(m_columns.size());
-    //tableWidget->setHorizontalHeaderLabels(columns);
-    for(int i=0;i<m_columns.size();++i){
-        QTableWidgetItem *hdr=new QTableWidgetItem(m_columns[i]);
-        hdr->setFlags(Qt::ItemIsUserCheckable|Qt::ItemIsEnabled);
-        hdr->setCheckState(Qt::Unchecked);
-        tableWidget->setHorizontalHeaderItem(i,hdr);
-        for(int row=0;row<m_csv[i].size();++row){
-            QTableWidgetItem *newItem = new QTableWidgetItem(m_csv[i].value(row));
-
-            tableWidget->setItem(row, i, newItem);
-        }
-
+    if(m_query){
+        updateFilteredTable();
+    }
+    if(m_columns.size()<=maxAutoResizeColumns){
+        tableView->resizeColumnsToContents();
+    }
+    if(btFilter->isChecked()){
+        applyColumnNameFilter();
     }
-    tableWidget->resizeColumnsToContents();
 }
 /*!
  * \brief update Sweep/plotvar list widget
@@ -771,6 +917,7 @@ void MainWindow::updateSweepGUI()
     foreach(const QString &elem,m_sweeps){
         QListWidgetItem *item=new QListWidgetItem(elem,lstSweeps);
         item->setCheckState(Qt::Checked);
+        updateSweepItem(item);
     }
     foreach(const QString &elem,m_plotValues){
         QListWidgetItem *item=new QListWidgetItem(elem,lstData);
@@ -810,10 +957,54 @@ void MainWindow::plotSelected()
     }
     int index_x=getIndex(xn);
 
+    // guard against mis-clicks which would create huge numbers of series
+    // a band replaces all series which only differ in the last sweep var
+    const bool bands=m_envelope.type!=EnvelopeSpec::ENV_NONE;
+    const QStringList seriesVars= bands ? vars.mid(0,vars.size()-1) : vars;
+    const bool limited=m_maxSeries>0 && !seriesVars.isEmpty();
+    int maxGroups=0;
+    bool asked=false;
+    // false if canceled, otherwise maxGroups is set (0 for all)
+    auto askLimit=[this,&maxGroups,&asked](const QString &text){
+        asked=true;
+        maxGroups=qMax(1,m_maxSeries/int(m_plotValues.size()));
+        QMessageBox box(QMessageBox::Warning,tr("Plot"),text);
+        QPushButton *btLargest=box.addButton(tr("Plot largest %1 groups").arg(maxGroups),QMessageBox::AcceptRole);
+        QPushButton *btAll=box.addButton(tr("Plot all"),QMessageBox::DestructiveRole);
+        box.addButton(QMessageBox::Cancel);
+        box.setDefaultButton(btLargest);
+        box.exec();
+        if(box.clickedButton()==btAll){
+            maxGroups=0;
+        }else if(box.clickedButton()!=btLargest){
+            return false;
+        }
+        return true;
+    };
+    if(limited){
+        // the estimate is an upper bound, it only saves grouping when far too many series are to be expected
+        const double estimate=estimateGroupCount(seriesVars)*m_plotValues.size();
+        if(estimate>double(groupingSeriesFactor)*m_maxSeries
+                && !askLimit(tr("The sweep selection creates up to about %1 series (limit %2).").arg(qRound64(estimate)).arg(m_maxSeries))){
+            return;
+        }
+    }
+    QList<LoopIteration> lits=groupBy(vars,m_visibleRows);
+    if(limited && !asked){
+        const qsizetype series=qsizetype(groupSpans(lits,bands).size())*m_plotValues.size();
+        if(series>m_maxSeries
+                && !askLimit(tr("The sweep selection creates %1 series (limit %2).").arg(series).arg(m_maxSeries))){
+            return;
+        }
+    }
+    if(maxGroups>0){
+        keepLargestGroups(lits,maxGroups,bands);
+    }
+
     bool multiPlot=m_plotValues.size()>1;
     chartView->clear();
     for(const QString &yn:m_plotValues){
-        addSeriesToChart(index_x,vars,yn,multiPlot);
+        addSeriesToChart(index_x,lits,yn,multiPlot);
     }
 
     chartView->setTitle("Line chart");
@@ -833,105 +1024,214 @@ void MainWindow::plotSelected()
  * \brief plot series
  * if x values contain strings, use a bar instead of a line chart
  * \param index_x
- * \param vars
+ * \param lits groups of rows, one series each
  * \param yn
  * \param multiPlot
  */
-void MainWindow::addSeriesToChart(const int index_x,const QStringList &vars,const QString &yn,bool multiPlot){
+void MainWindow::addSeriesToChart(const int index_x,const QList<LoopIteration> &lits,const QString &yn,bool multiPlot){
     bool discretePoints=false; //(m_columnType[index_x]!=COL_INT) && (m_columnType[index_x]!=COL_FLOAT); for now, detection not done generally
     if(discretePoints){
-        addBarSeriesToChart(index_x,vars,yn,multiPlot);
+        addBarSeriesToChart(index_x,lits,yn,multiPlot);
     }else{
-        addLineSeriesToChart(index_x,vars,yn,multiPlot);
+        addLineSeriesToChart(index_x,lits,yn,multiPlot);
     }
 }
 /*!
  * \brief add LineSeries To Chart
  * Assume x is number
  * \param index_x column of x (sweep) value
- * \param vars group vars
+ * \param lits groups of rows, one series each
  * \param yn plot value
  * \param multiPlot if multiple values will be plotted
  */
-void MainWindow::addLineSeriesToChart(const int index_x, const QStringList &vars, const QString &yn, bool multiPlot)
+void MainWindow::addLineSeriesToChart(const int index_x, const QList<LoopIteration> &lits, const QString &yn, bool multiPlot)
 {
     int index_y=getIndex(yn);
     if(index_y<0) return;
-    bool averaging=m_lineSeriesAveragedAct->isChecked();
-    QList<LoopIteration> lits=groupBy(vars,m_visibleRows);
-    foreach(LoopIteration lit,lits){
+    // numbers are fetched here, groups are aggregated in parallel
+    const double *x= index_x<0 ? nullptr : m_store.numbers(index_x).data();
+    const double *y=m_store.numbers(index_y).data();
+    const AggregationSpec spec=m_aggregation;
+    const bool sortX=m_sortX && m_envelope.type==EnvelopeSpec::ENV_NONE; // envelopes are sorted anyway
+    std::vector<QList<QPointF>> points(lits.size());
+    parallelFor(lits.size(),1,[&](qsizetype begin,qsizetype end){
+        for(qsizetype i=begin;i<end;++i){
+            points[i]=aggregateRows(x,y,lits.at(i).indices,spec,sortX);
+        }
+    });
+    QString yName=yn;
+    if(spec.type!=AggregationSpec::AGG_NONE){
+        yName=spec.name()+"("+yn+")";
+    }
+    if(m_envelope.type!=EnvelopeSpec::ENV_NONE){
+        addEnvelopeSeriesToChart(lits,points,yName,multiPlot);
+        return;
+    }
+    for(int i=0;i<lits.size();++i){
+        const LoopIteration &lit=lits.at(i);
         QLineSeries *series = new QLineSeries();
         if(!lit.value.isEmpty()){
             QString name=lit.value.left(lit.value.size()-1);
-            if(multiPlot)
-                name=yn+":"+name;
+            if(multiPlot || spec.type!=AggregationSpec::AGG_NONE)
+                name=yName+":"+name;
             series->setName(name);
         }else{
-            series->setName(yn);
+            series->setName(yName);
         }
-        QList<QPointF> points=getPoints(index_x,index_y,lit);
-        if(averaging){
-            points=averagePointSeries(points);
-        }
-        series->append(points);
+        series->append(points[i]);
         chartView->addSeries(series);
     }
 }
-
-QList<QPointF> MainWindow::getPoints(const int index_x,const int index_y,const LoopIteration &lit)
+/*!
+ * \brief add one band per group of series which only differ in the last sweep var
+ * Series of one band are consecutive in lits. Their points are joined on x
+ * and the envelope is computed per band in parallel.
+ * Each band is drawn as area between low and high plus a line through the mean.
+ * \param lits groups of rows
+ * \param points points per group
+ * \param yName
+ * \param multiPlot
+ */
+void MainWindow::addEnvelopeSeriesToChart(const QList<LoopIteration> &lits, const std::vector<QList<QPointF>> &points, const QString &yName, bool multiPlot)
 {
-    QList<QPointF> series;
-    qreal cnt=0;
-    for(std::size_t i=0;i<lit.indices.size();++i){
-        if(lit.indices[i]){
-            bool ok_x,ok_y;
-            qreal x;
-            if(index_x<0){
-                x=cnt;
-                cnt+=1;
-                ok_x=true;
-            }else{
-                x=m_csv[index_x].value(i).toDouble(&ok_x);
-            }
+    std::vector<std::size_t> starts; // first group of each band, plus end
+    QStringList keys;
+    for(int i=0;i<lits.size();++i){
+        if(i==0 || lits.at(i).bandValues!=lits.at(i-1).bandValues){
+            starts.push_back(i);
+            keys<<lits.at(i).band;
+        }
+    }
+    starts.push_back(lits.size());
+    const EnvelopeSpec spec=m_envelope;
+    std::vector<std::vector<EnvelopePoint>> envelopes(keys.size());
+    parallelFor(keys.size(),1,[&](qsizetype begin,qsizetype end){
+        for(qsizetype i=begin;i<end;++i){
+            envelopes[i]=envelopeOf(points,starts[i],starts[i+1],spec);
+        }
+    });
+    for(int i=0;i<keys.size();++i){
+        QString name=yName;
+        if(!keys.at(i).isEmpty()){
+            name=keys.at(i).left(keys.at(i).size()-1);
+            if(multiPlot || m_aggregation.type!=AggregationSpec::AGG_NONE)
+                name=yName+":"+name;
+        }
+        QList<QPointF> low,center,high;
+        low.reserve(int(envelopes[i].size()));
+        center.reserve(int(envelopes[i].size()));
+        high.reserve(int(envelopes[i].size()));
+        for(const EnvelopePoint &p:envelopes[i]){
+            low.append(QPointF(p.x,p.low));
+            center.append(QPointF(p.x,p.center));
+            high.append(QPointF(p.x,p.high));
+        }
+        QLineSeries *series = new QLineSeries();
+        series->setName(name);
+        series->append(center);
+        chartView->addSeries(series);
 
-            qreal y=m_csv[index_y].value(i).toDouble(&ok_y);
-            if(ok_x && ok_y){
-                QPointF pt(x,y);
-                series.append(pt);
-            }
+        QAreaSeries *area = new QAreaSeries();
+        QLineSeries *upper = new QLineSeries(area);
+        upper->append(high);
+        QLineSeries *lower = new QLineSeries(area);
+        lower->append(low);
+        area->setUpperSeries(upper);
+        area->setLowerSeries(lower);
+        area->setName(name+" "+spec.name());
+        chartView->addSeries(area);
+        // same color as center line, transparent
+        QColor color=series->color();
+        area->setBorderColor(color);
+        color.setAlpha(60);
+        area->setColor(color);
+    }
+}
+/*!
+ * \brief show pivot table of the selected sweeps
+ * Outer sweep vars form the rows, the last one the columns,
+ * the first plot var is aggregated with the aggregation of the plot menu (mean if none).
+ */
+void MainWindow::pivotFromSweeps()
+{
+    updateSweeps();
+    PivotSpec spec;
+    spec.rowKeys=m_sweeps;
+    if(!spec.rowKeys.isEmpty()){
+        spec.columnKeys<<spec.rowKeys.takeLast();
+    }
+    spec.value=m_plotValues.value(0);
+    spec.aggregation=m_aggregation;
+    if(spec.aggregation.type==AggregationSpec::AGG_NONE){
+        spec.aggregation.type=AggregationSpec::AGG_MEAN;
+    }
+    pivotView->setSpec(spec);
+    tabWidget->setCurrentWidget(pivotView);
+}
+/*!
+ * \brief aggregation of y per x selected in plot menu
+ * Percentile asks for the percentage.
+ */
+void MainWindow::aggregationChanged()
+{
+    QAction *act=qobject_cast<QAction*>(sender());
+    AggregationSpec spec;
+    spec.type=static_cast<AggregationSpec::Type>(act->data().toInt());
+    spec.percentile=m_aggregation.percentile;
+    if(spec.type==AggregationSpec::AGG_PERCENTILE){
+        bool ok;
+        spec.percentile=QInputDialog::getDouble(this,tr("Percentile"),tr("Percentile (0..100):"),spec.percentile,0,100,2,&ok);
+        if(!ok){
+            spec=m_aggregation;
+        }
+    }
+    m_aggregation=spec;
+    // keep check mark on active aggregation
+    for(QAction *elem:m_aggregationMenu->actions()){
+        if(elem->data().toInt()==m_aggregation.type){
+            elem->setChecked(true);
         }
     }
-    return series;
+    plotStyleChanged();
 }
 /*!
- * \brief calculate average of y values with same x values
- * Series need to be sorted
- * \param points
+ * \brief switch sorting of points by x
+ * Rows which are not ordered by x would draw zig-zag lines otherwise.
+ * \param checked
  */
-QList<QPointF> MainWindow::averagePointSeries(const QList<QPointF> &points)
+void MainWindow::sortXChanged(bool checked)
 {
-    QList<QPointF> avg;
-    int n=0;
-    QPointF resultingPoint;
-    for(const auto &pt:points){
-        if(n==0){
-            resultingPoint=pt;
-            ++n;
-        }else{
-            if(pt.x()==resultingPoint.x()){
-                resultingPoint.setY(resultingPoint.y()+pt.y());
-                ++n;
-            }else{
-                resultingPoint.setY(resultingPoint.y()/n);
-                avg<<resultingPoint;
-                n=0;
-            }
+    m_sortX=checked;
+    plotStyleChanged();
+}
+/*!
+ * \brief band mode selected in plot menu
+ * Mean +- k sigma asks for k.
+ */
+void MainWindow::envelopeChanged()
+{
+    QAction *act=qobject_cast<QAction*>(sender());
+    EnvelopeSpec spec;
+    spec.type=static_cast<EnvelopeSpec::Type>(act->data().toInt());
+    spec.sigmas=m_envelope.sigmas;
+    if(spec.type==EnvelopeSpec::ENV_SIGMA){
+        bool ok;
+        spec.sigmas=QInputDialog::getDouble(this,tr("Band"),tr("k of mean +- k sigma:"),spec.sigmas,0,100,2,&ok);
+        if(!ok){
+            spec=m_envelope;
+        }
+    }
+    m_envelope=spec;
+    // keep check mark on active band mode
+    for(QAction *elem:m_envelopeMenu->actions()){
+        if(elem->data().toInt()==m_envelope.type){
+            elem->setChecked(true);
         }
     }
-    return avg;
+    plotStyleChanged();
 }
 
-void MainWindow::addBarSeriesToChart(const int index_x, const QStringList &vars, const QString &yn, bool multiPlot)
+void MainWindow::addBarSeriesToChart(const int index_x, const QList<LoopIteration> &lits, const QString &yn, bool multiPlot)
 {
     // TO BE IMPLEMENTED
     return;
@@ -952,7 +1252,7 @@ void MainWindow::tabChanged(int index)
  */
 void MainWindow::headerMenuRequested(QPoint pt)
 {
-    int column=tableWidget->horizontalHeader()->logicalIndexAt(pt);
+    int column=tableView->horizontalHeader()->logicalIndexAt(pt);
 
     QMenu *menu=new QMenu(this);
     QAction *act=new QAction(tr("add as sweep var"), this);
@@ -979,6 +1279,25 @@ void MainWindow::headerMenuRequested(QPoint pt)
         connect(act,&QAction::triggered,this,&MainWindow::showDecimal);
         menu->addAction(act);
         addSeparator=true;
+    }else{
+        if(isFloatOnlyData(column)){
+            act=new QAction(tr("show engineering"), this);
+            act->setData(column);
+            connect(act,&QAction::triggered,this,&MainWindow::showEngineering);
+            menu->addAction(act);
+            act=new QAction(tr("show fixed precision"), this);
+            act->setData(column);
+            connect(act,&QAction::triggered,this,&MainWindow::showFixed);
+            menu->addAction(act);
+            addSeparator=true;
+        }
+    }
+    if(m_model->displayFormat(column)!=CsvTableModel::FMT_DEFAULT){
+        act=new QAction(tr("show as read"), this);
+        act->setData(column);
+        connect(act,&QAction::triggered,this,&MainWindow::showDefault);
+        menu->addAction(act);
+        addSeparator=true;
     }
     if(isPosFloatOnlyData(column)){
         act=new QAction(tr("float -> dB20"), this);
@@ -1023,26 +1342,35 @@ void MainWindow::headerMenuRequested(QPoint pt)
     act->setData(column);
     connect(act,&QAction::triggered,this,&MainWindow::columnFilter);
     menu->addAction(act);
-    QStringList lst=m_csv[column];
-    lst.removeDuplicates();
-    if(lst.size()<20){
-        int cfi=getColumnFilter(column);
-        for(const QString &elem:lst){
-            act=new QAction(elem, this);
-            act->setCheckable(true);
-            bool check=true;
-            if(cfi>=0){
-                if(!m_columnFilters[cfi].allowedValues.contains(elem))
-                    check=false;
-            }
-            act->setChecked(check);
-            act->setData(column);
-            connect(act,&QAction::toggled,this,&MainWindow::filterElementChanged);
-            menu->addAction(act);
+    menu->addSeparator();
+    const ColumnDictionary *dict=m_store.dictionary(column); // columns without dictionary have many distinct values
+    const int cfi=getColumnFilter(column);
+    if(cfi>=0 && !m_columnFilters[cfi].query.isEmpty()){
+        // picking values would replace the query
+        act=new QAction(tr("column filtered by query, edit with \"filter\""), this);
+        act->setEnabled(false);
+        menu->addAction(act);
+    }else if(dict){
+        ValuePicker *picker=new ValuePicker(column);
+        picker->setMinimumSize(250,300);
+        bool valueFilter=cfi>=0;
+        QSet<QString> allowed;
+        if(valueFilter){
+            const QStringList &allowedValues=m_columnFilters[cfi].allowedValues;
+            allowed=QSet<QString>(allowedValues.begin(),allowedValues.end());
         }
+        picker->setValues(dict->values,dict->counts,allowed,!valueFilter);
+        connect(picker,&ValuePicker::selectionChanged,this,&MainWindow::valuePickerChanged);
+        QWidgetAction *widgetAction=new QWidgetAction(menu);
+        widgetAction->setDefaultWidget(picker);
+        menu->addAction(widgetAction);
+    }else{
+        act=new QAction(tr("too many distinct values to list"), this);
+        act->setEnabled(false);
+        menu->addAction(act);
     }
-
-    menu->popup(tableWidget->horizontalHeader()->viewport()->mapToGlobal(pt));
+    menu->setAttribute(Qt::WA_DeleteOnClose);
+    menu->popup(tableView->horizontalHeader()->viewport()->mapToGlobal(pt));
 }
 /*!
  * \brief add Sweep Var
@@ -1054,8 +1382,101 @@ void MainWindow::addSweepVar()
     m_sweeps.prepend(var);
     QListWidgetItem *item=new QListWidgetItem(var);
     item->setCheckState(Qt::Checked);
+    updateSweepItem(item);
     lstSweeps->insertItem(0,item);
 }
+/*!
+ * \brief context menu of sweep var list
+ * Continuous sweep vars can be binned instead of grouping by every distinct value.
+ * \param pt
+ */
+void MainWindow::sweepMenuRequested(QPoint pt)
+{
+    QListWidgetItem *item=lstSweeps->itemAt(pt);
+    if(!item) return;
+    const QString var=item->text();
+    const BinSpec spec=m_binning.value(var);
+    QMenu *menu=new QMenu(this);
+    QActionGroup *group=new QActionGroup(menu);
+    const QStringList texts={tr("no binning"),tr("fixed width bins..."),tr("quantile bins..."),tr("cluster by tolerance...")};
+    for(int mode=BinSpec::BIN_NONE;mode<=BinSpec::BIN_TOLERANCE;++mode){
+        QAction *act=new QAction(texts.at(mode),group);
+        act->setCheckable(true);
+        act->setChecked(spec.mode==mode);
+        connect(act,&QAction::triggered,this,[this,var,mode](){
+            setBinning(var,static_cast<BinSpec::Mode>(mode));
+        });
+        menu->addAction(act);
+    }
+    menu->setAttribute(Qt::WA_DeleteOnClose);
+    menu->popup(lstSweeps->viewport()->mapToGlobal(pt));
+}
+/*!
+ * \brief ask for bin parameter and set binning of sweep var
+ * \param var
+ * \param mode
+ */
+void MainWindow::setBinning(const QString &var, BinSpec::Mode mode)
+{
+    BinSpec spec=m_binning.value(var);
+    bool ok=true;
+    switch(mode){
+    case BinSpec::BIN_WIDTH:
+        spec.parameter=QInputDialog::getDouble(this,tr("Binning"),tr("Bin width of %1:").arg(var),
+                                               spec.mode==mode ? spec.parameter : 1,0,1e300,6,&ok);
+        ok=ok && spec.parameter>0;
+        break;
+    case BinSpec::BIN_QUANTILE:
+        spec.parameter=QInputDialog::getInt(this,tr("Binning"),tr("Number of bins of %1:").arg(var),
+                                            spec.mode==mode ? int(spec.parameter) : 10,1,10000,1,&ok);
+        break;
+    case BinSpec::BIN_TOLERANCE:
+        spec.parameter=QInputDialog::getDouble(this,tr("Binning"),tr("Tolerance of %1:").arg(var),
+                                               spec.mode==mode ? spec.parameter : 0.1,0,1e300,6,&ok);
+        break;
+    default:
+        spec.parameter=0;
+        break;
+    }
+    if(!ok) return;
+    spec.mode=mode;
+    if(spec.isActive()){
+        m_binning.insert(var,spec);
+    }else{
+        m_binning.remove(var);
+    }
+    for(int i=0;i<lstSweeps->count();++i){
+        if(lstSweeps->item(i)->text()==var){
+            updateSweepItem(lstSweeps->item(i));
+        }
+    }
+}
+/*!
+ * \brief show binning of sweep var as tooltip
+ * \param item
+ */
+void MainWindow::updateSweepItem(QListWidgetItem *item)
+{
+    const BinSpec spec=m_binning.value(item->text());
+    QString text;
+    switch(spec.mode){
+    case BinSpec::BIN_WIDTH:
+        text=tr("bins of width %1").arg(spec.parameter);
+        break;
+    case BinSpec::BIN_QUANTILE:
+        text=tr("%1 quantile bins").arg(spec.parameter);
+        break;
+    case BinSpec::BIN_TOLERANCE:
+        text=tr("clustered with tolerance %1").arg(spec.parameter);
+        break;
+    default:
+        break;
+    }
+    item->setToolTip(text);
+    QFont font=item->font();
+    font.setItalic(spec.isActive());
+    item->setFont(font);
+}
 /*!
  * \brief remove var from sweepvar/plotvar, depending which one is focused
  */
@@ -1240,10 +1661,11 @@ void MainWindow::filterToggled(bool checked)
     // filter columns
     if(!checked){
         for(int i=0;i<m_columns.size();++i){
-            tableWidget->showColumn(i);
+            tableView->showColumn(i);
         }
+        recomputeSelectionStats();
     }else{
-        filterTextChanged(leFilterText->text());
+        applyColumnNameFilter();
     }
 }
 /*!
@@ -1253,7 +1675,7 @@ void MainWindow::filterToggled(bool checked)
 void MainWindow::regexToggled(bool )
 {
     // filter columns
-    filterTextChanged(leFilterText->text());
+    applyColumnNameFilter();
 }
 /*!
  * \brief filter to only columns which are checked on header
@@ -1275,43 +1697,61 @@ void MainWindow::filterPlotToggled(bool checked)
     // filter columns
     for(int i=0;i<m_columns.size();++i){
         if(!checked){
-            tableWidget->showColumn(i);
+            tableView->showColumn(i);
         }else{
             QString text=m_columns.value(i);
             if(m_sweeps.contains(text) || m_plotValues.contains(text) || hasColumnFilter(i)){
-                tableWidget->showColumn(i);
+                tableView->showColumn(i);
             }else{
-                tableWidget->hideColumn(i);
+                tableView->hideColumn(i);
             }
         }
     }
+    recomputeSelectionStats();
 }
 /*!
  * \brief filter text was changed
- * Filtering is updated if turned on
+ * Filtering is updated if turned on.
+ * Update is delayed until typing pauses.
  * \param text
  */
 void MainWindow::filterTextChanged(const QString &text)
 {
+    Q_UNUSED(text);
     if(!btFilter->isChecked()){
         btFilter->setChecked(true);
     }
-    bool useRegex=btRegExp->isChecked();
-    if(btFilter->isChecked()){
-        for(int i=0;i<m_columns.size();++i){
-            bool show=false;
-            if(useRegex){
-                show=m_columns.value(i).contains(QRegularExpression(text));
-            }else{
-                show=m_columns.value(i).contains(text, Qt::CaseInsensitive);
-            }
-            if(show){
-                tableWidget->showColumn(i);
-            }else{
-                tableWidget->hideColumn(i);
-            }
+    m_filterTimer->start();
+}
+/*!
+ * \brief show only columns whose name matches the filter text
+ * Matcher is compiled once per update, only changed columns are shown/hidden.
+ */
+void MainWindow::applyColumnNameFilter()
+{
+    m_filterTimer->stop();
+    if(!btFilter->isChecked()) return;
+    const QString text=leFilterText->text();
+    const bool useRegex=btRegExp->isChecked();
+    QRegularExpression re;
+    if(useRegex){
+        re.setPattern(text);
+        if(!re.isValid()) return;
+        re.optimize();
+    }
+    const QStringMatcher matcher(text,Qt::CaseInsensitive);
+    for(int i=0;i<m_columns.size();++i){
+        bool show=true;
+        if(useRegex){
+            show=re.match(m_columns.at(i)).hasMatch();
+        }else{
+            show=text.isEmpty() || matcher.indexIn(m_columns.at(i))>=0;
+        }
+        if(tableView->isColumnHidden(i)==show){
+            tableView->setColumnHidden(i,!show);
         }
     }
+    recomputeSelectionStats();
 }
 
 void MainWindow::columnShowAll()
@@ -1327,29 +1767,11 @@ void MainWindow::columnShowAll()
 }
 
 void MainWindow::updateColBackground(int col,bool filtered){
-    // color filter columns
-    for(int row=0;row<tableWidget->rowCount();++row){
-        QTableWidgetItem *item=tableWidget->item(row,col);
-        if(filtered)
-            item->setBackground(Qt::cyan);
-        else{
-            QColor color=QApplication::palette().color(QPalette::Base);
-            item->setBackground(color);
-        }
-    }
-    // color header
-    QTableWidgetItem *item=tableWidget->horizontalHeaderItem(col);
-    if(filtered){
-        QColor color=QApplication::palette().color(QPalette::Midlight);
-        item->setBackground(color);
-    }else{
-        QColor color=QApplication::palette().color(QPalette::Button);
-        item->setBackground(color);
-    }
+    // color filter columns, done by model
+    m_model->setFilterState(col,filtered ? CsvTableModel::FILTER_ACTIVE : CsvTableModel::FILTER_NONE);
 }
 void MainWindow::updateColBackgroundOff(int col){
-    QTableWidgetItem *item=tableWidget->horizontalHeaderItem(col);
-    item->setBackground(Qt::red);
+    m_model->setFilterState(col,CsvTableModel::FILTER_OFF);
 }
 
 void MainWindow::columnShowNone()
@@ -1359,6 +1781,7 @@ void MainWindow::columnShowNone()
     int cfi=getColumnFilter(column);
     if(cfi>=0){
         m_columnFilters[cfi].allowedValues.clear();
+        m_columnFilters[cfi].result.reset();
     }else{
         ColumnFilter cf;
         cf.column=column;
@@ -1373,254 +1796,306 @@ void MainWindow::columnShowNone()
  */
 void MainWindow::columnFilter()
 {
-    // ask for filter as text
-    bool ok;
-    QString text=tr("use ><=&|,");
-
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
+    QString text;
     int cfi=getColumnFilter(column);
     if(cfi>=0){
-        ColumnFilter &cf=m_columnFilters[cfi];
-        text=cf.query;
-        if(text.isEmpty())
-            text=tr("use ><=&|contains");
+        text=m_columnFilters[cfi].query;
+    }
+    if(!m_filterEditor){
+        m_filterEditor=new FilterEditor(this);
+        m_filterEditor->setSource(&m_csv,&m_store);
+        connect(m_filterEditor,&FilterEditor::filterApplied,this,&MainWindow::applyColumnFilter);
+    }
+    m_filterEditor->setColumn(column,m_columns.value(column),text,rowsPassingOtherFilters(column));
+    m_filterEditor->show();
+    m_filterEditor->raise();
+    m_filterEditor->activateWindow();
+}
+/*!
+ * \brief set query as filter of column
+ * An empty query removes the filter.
+ * \param column
+ * \param query
+ */
+void MainWindow::applyColumnFilter(int column, const QString &query)
+{
+    int cfi=getColumnFilter(column);
+    if(query.trimmed().isEmpty()){
+        if(cfi>=0){
+            m_columnFilters.removeAt(cfi);
+            updateColBackground(column,false);
+            updateFilteredTable();
+        }
+        return;
     }
-    text = QInputDialog::getText(this, tr("Column filter"),
-                                             tr("Query:"), QLineEdit::Normal,
-                                             text, &ok);
-    if (!ok)
-        return; // no filter set
-
     if(cfi>=0){
         ColumnFilter &cf=m_columnFilters[cfi];
-        cf.query=text;
+        cf.query=query;
+        compileColumnFilter(cf);
     }else{
         ColumnFilter cf;
         cf.column=column;
-        cf.query=text;
+        cf.query=query;
+        compileColumnFilter(cf);
         m_columnFilters.append(cf);
-        updateColBackground(column,true);
     }
+    updateColBackground(column,true);
     updateFilteredTable();
 }
+/*!
+ * \brief rows passing all filters except the one on column
+ * Uses the cached filter results.
+ * \param column
+ * \return
+ */
+RowSelection MainWindow::rowsPassingOtherFilters(int column) const
+{
+    if(m_csv.isEmpty()) return RowSelection();
+    RowSelection rows(m_csv[0].size(),true);
+    for(const ColumnFilter &cf:m_columnFilters){
+        if(cf.column!=column && cf.result){
+            rows&=*cf.result;
+        }
+    }
+    if(m_query && m_queryResult){
+        rows&=*m_queryResult;
+    }
+    return rows;
+}
 
+/*!
+ * \brief update visible rows from column filters
+ * Each filter and the query bar keep their result, visible rows are the intersection of all results.
+ */
 void MainWindow::updateFilteredTable()
 {
     if(m_csv.isEmpty()) return;
     int sz=m_csv[0].size();
-    m_visibleRows.resize(sz);
-    std::fill(m_visibleRows.begin(),m_visibleRows.end(),true);
-    QList<int> colsFiltered;
-    for(const ColumnFilter &cf:m_columnFilters){
-        filterRowsForColumnValues(cf);
-        colsFiltered.append(cf.column);
+    RowSelection visible(sz,true);
+    for(ColumnFilter &cf:m_columnFilters){
+        if(!cf.result){
+            // only filters which changed are evaluated again, unless the state was seen before
+            const QString key=filterCacheKey(cf);
+            cf.result=m_filterCache.find(key);
+            if(!cf.result){
+                QSharedPointer<RowSelection> result(new RowSelection(sz,true));
+                filterRowsForColumnValues(cf,*result);
+                result->optimize();
+                m_filterCache.insert(key,result);
+                cf.result=result;
+            }
+        }
+        visible&=*cf.result;
+    }
+    if(m_query){
+        if(!m_queryResult){
+            QSharedPointer<RowSelection> result(new RowSelection(sz,true));
+            m_query->evaluate(m_csv,m_store,*result);
+            result->optimize();
+            m_queryResult=result;
+        }
+        visible&=*m_queryResult;
     }
-    for(int i=0;i<tableWidget->rowCount();++i){
-        bool hide = !m_visibleRows.at(i);
-        tableWidget->setRowHidden(i,hide);
+    visible.optimize();
+    m_visibleRows=std::move(visible);
+    m_model->setVisibleRows(m_visibleRows);
+    pivotView->setSelection(m_visibleRows);
+    if(m_filterEditor && m_filterEditor->isVisible()){
+        // counts of the open editor are relative to the other filters
+        m_filterEditor->setContext(rowsPassingOtherFilters(m_filterEditor->column()));
     }
-
 }
 
-void MainWindow::filterRowsForColumnValues(ColumnFilter cf)
+/*!
+ * \brief remove rows from visible rows which don't pass column filter
+ * Queries are evaluated block-wise in parallel into a bitmap which is and-ed word-wise to visible.
+ * \param cf
+ * \param visible
+ */
+void MainWindow::filterRowsForColumnValues(const ColumnFilter &cf, RowSelection &visible)
 {
     int column=cf.column;
-    ColumnType col_type=COL_STRING;
-    if(!cf.query.isEmpty()){
-        col_type=getDataType(column);
-    }
-    QStringList &colVals=m_csv[column];
-    for(int i=0;i<colVals.size();++i){
-        if(m_visibleRows[i]){
-            if(cf.query.isEmpty()){
-                if(!cf.allowedValues.contains(colVals[i])){
-                    m_visibleRows[i]=false;
+    const QStringList &colVals=m_csv.at(column);
+    const qsizetype rows=colVals.size();
+    quint64 *words=visible.words();
+    if(cf.query.isEmpty()){
+        const QSet<QString> allowedValues(cf.allowedValues.constBegin(),cf.allowedValues.constEnd());
+        const ColumnDictionary *dict=m_store.dictionary(column);
+        if(dict){
+            // check once per distinct value, then one pass over the codes
+            std::vector<quint8> allowed(dict->values.size());
+            for(qsizetype code=0;code<dict->values.size();++code){
+                allowed[code]=allowedValues.contains(dict->values.at(code));
+            }
+            const quint32 *codes=dict->codes.data();
+            parallelFor(rows,filterBlockSize,[&allowed,codes,words](qsizetype begin,qsizetype end){
+                for(qsizetype w=begin/64;w*64<end;++w){
+                    const qsizetype n=qMin<qsizetype>(64,end-w*64);
+                    quint64 bits=0;
+                    for(qsizetype j=0;j<n;++j){
+                        bits|=quint64(allowed[codes[w*64+j]])<<j;
+                    }
+                    words[w]&=bits;
                 }
+            });
+            return;
+        }
+        parallelFor(rows,filterBlockSize,[&allowedValues,&colVals,words](qsizetype begin,qsizetype end){
+            for(qsizetype i=begin;i<end;++i){
+                if(!allowedValues.contains(colVals[i])){
+                    words[i>>6]&=~(quint64(1)<<(i&63));
+                }
+            }
+        });
+        return;
+    }
+    if(!cf.compiledQuery || cf.compiledQuery->isEmpty()) return;
+    FilterQuery &query=*cf.compiledQuery;
+    double low,high;
+    bool lowInclusive,highInclusive;
+    if(query.numericRange(low,lowInclusive,high,highInclusive)){
+        // repeatedly filtered range: binary search in sorted index instead of scan
+        const SortedIndex *index=m_store.rangeIndex(column);
+        if(index){
+            qsizetype first,last;
+            index->range(low,lowInclusive,high,highInclusive,first,last);
+            if((last-first)*32<rows){
+                std::vector<int> ids(index->rows.begin()+first,index->rows.begin()+last);
+                std::sort(ids.begin(),ids.end());
+                visible&=RowSelection::fromRows(rows,std::move(ids));
             }else{
-                m_visibleRows[i]=parseQuery(cf.query,colVals[i],col_type);
+                RowSelection pass(rows);
+                quint64 *passWords=pass.words();
+                for(qsizetype i=first;i<last;++i){
+                    const int row=index->rows[i];
+                    passWords[row>>6]|=quint64(1)<<(row&63);
+                }
+                visible&=pass;
             }
+            return;
         }
     }
+    FilterInput input;
+    input.cells=&colVals;
+    if(query.isNumeric()){
+        input.numbers=m_store.numbers(column).data();
+    }
+    if(query.hasTextTerms()){
+        input.dictionary=m_store.dictionary(column);
+    }
+    query.prepare(input);
+    // blocks write disjoint words of visible, no locking needed
+    parallelFor(rows,filterBlockSize,[&query,&input,words](qsizetype begin,qsizetype end){
+        std::vector<quint64> pass(RowSelection::wordsFor(end-begin));
+        query.evaluate(input,begin,end,pass.data());
+        andKernel(words+begin/64,pass.data(),RowSelection::wordsFor(end-begin));
+    });
 }
-
-void MainWindow::filterElementChanged(bool checked)
+/*!
+ * \brief compile text of query bar against current data
+ * Errors are shown in the status bar, the query is not applied then.
+ * \return false on error
+ */
+bool MainWindow::compileQuery()
 {
-    QAction *act=qobject_cast<QAction*>(sender());
-    int column=act->data().toInt();
-    QString value=act->text();
-    int cfi=getColumnFilter(column);
-    if(cfi<0){
-        ColumnFilter cf;
-        cf.column=column;
-        QStringList lst=m_csv[column];
-        lst.removeDuplicates();
-        cf.allowedValues=lst;
-        m_columnFilters.append(cf);
-        cfi=m_columnFilters.size()-1;
-        updateColBackground(column,true);
-    }
-    if(checked){
-        m_columnFilters[cfi].allowedValues.append(value);
-        //remove filter if all is allowed
-        QStringList lst=m_csv[column];
-        lst.removeDuplicates();
-        if(lst.size()==m_columnFilters[cfi].allowedValues.size()){
-            // assume identical
-            updateColBackground(column,false);
-            m_columnFilters.takeAt(cfi);
-        }
-        if(m_columnFilters[cfi].allowedValues.size()==1){
-            updateColBackground(column,true);
-        }
+    QSharedPointer<QueryExpression> query(new QueryExpression);
+    const bool ok=query->compile(leQuery->text(),m_columnIndex,m_store);
+    if(ok){
+        leQuery->setToolTip(QString());
+        leQuery->setStyleSheet(QString());
     }else{
-        m_columnFilters[cfi].allowedValues.removeOne(value);
+        const QString message=tr("Query: %1").arg(query->errorString());
+        leQuery->setToolTip(message);
+        leQuery->setStyleSheet("QLineEdit{color: red}");
+        statusBar()->showMessage(message,5000);
     }
-    if(m_columnFilters[cfi].allowedValues.isEmpty()){
-        updateColBackgroundOff(column);
+    if(!ok || query->isEmpty()){
+        query.reset();
     }
+    m_query=query;
+    return ok;
+}
+/*!
+ * \brief apply text of query bar as filter
+ */
+void MainWindow::applyQuery()
+{
+    m_queryResult.reset();
+    compileQuery(); // on error the query bar is ignored
     updateFilteredTable();
 }
 /*!
- * \brief interpret query to check if data is valid or not
- * \param text
- * \param data
+ * \brief key of column filter state for filter cache
+ * Column, its data generation and the normalized query or the sorted allowed values.
+ * \param cf
  * \return
  */
-bool MainWindow::parseQuery(const QString &text, const QString &data,const ColumnType col_type)
-{
-    QList<Query> queries;
-    for(int start=0;start<text.length();){
-        int end=text.indexOf('&',start);
-        int end_=text.indexOf('|',start);
-        bool andOperator=true;
-        if(end_>=0 && (end_<end || end<0) ){
-            end=end_;
-            andOperator=false;
-        }
-        if(end>=0){
-            Query q{text.mid(start,end-start).trimmed(),andOperator};
-            queries<<q;
-            start=end+1;
-            continue;
-        }
-        Query q{text.mid(start).trimmed(),andOperator};
-        queries<<q;
-        break;
-    }
-
-    bool res=true;
-    bool useAnd=true;
-    for(auto &qu:queries){
-        QString q=qu.query;
-        QString reference;
-        int operatorType=determineOperator(q,reference);
-        if(operatorType<-10) continue; // unknown operator
-        bool res_query=true;
-        if(operatorType>=10){
-            if(operatorType==10){
-                // contains ...
-                res_query=data.contains(reference);
-            }
-            if(operatorType==11){
-                // !contains ...
-                res_query=!data.contains(reference);
-            }
-            if(operatorType==12){
-                // regex ...
-                res_query=data.contains(QRegularExpression(reference));
-            }
-            if(operatorType==13){
-                // !regex ...
-                res_query=!data.contains(QRegularExpression(reference));
-            }
-        }else{
-            int result;
-            if(col_type==COL_STRING){
-                result=compare(data,reference);
-            }
-            if(col_type==COL_FLOAT){
-                double number=data.toDouble();
-                double ref=reference.toDouble();
-                result=compare(number,ref);
-            }
-            if(col_type==COL_INT){
-                bool ok;
-                qulonglong number=convertStringToLong(data,ok);
-                qulonglong ref=convertStringToLong(reference,ok);
-                result=compare(number,ref);
-            }
-            // determine if compare was correct
-            if(result==0){
-                if(abs(operatorType)>1){
-                    res_query=false; // equale but should be >/<
-                }
-            }else{
-                // result 1 or -1
-                if(operatorType!=-3 && (operatorType==0 || (operatorType/result)<0)){
-                    res_query=false; // opposite i.e. >/>= but compare less
-                }
-            }
-        }
-        if(useAnd){
-            res=res&res_query;
-        }else{
-            res=res|res_query;
-        }
-        useAnd=qu.connectAnd;
+QString MainWindow::filterCacheKey(const ColumnFilter &cf) const
+{
+    QString key=QString("%1:%2:").arg(cf.column).arg(m_store.generation(cf.column));
+    if(cf.query.isEmpty()){
+        QStringList values=cf.allowedValues;
+        values.sort();
+        values.removeDuplicates();
+        key+="in:"+values.join(QChar(0x1f));
+    }else{
+        key+="q:"+(cf.compiledQuery ? cf.compiledQuery->normalized() : QString());
     }
-    return res;
+    return key;
 }
 /*!
- * \brief detremine operator and the corresponding reference
- * e.g. ">=0" -> ">="=2 , "0"
- * \param text
- * \param reference
- * \return opType (2 >=,1 >,0 =,-1 <=, -2 <,-3 !=, -1000 uknown, 10 contains,11 !contains)
+ * \brief compile query of column filter
+ * Needs to be redone when the query or the column type changes.
+ * \param cf
  */
-int MainWindow::determineOperator(const QString &text, QString &reference)
+void MainWindow::compileColumnFilter(ColumnFilter &cf)
 {
-    if(text.startsWith(">=")){
-        reference=text.mid(2);
-        return 1;
-    }
-    if(text.startsWith("<=")){
-        reference=text.mid(2);
-        return -1;
-    }
-    if(text.startsWith("!=")){
-        reference=text.mid(2);
-        return -3;
-    }
-    if(text.startsWith('>')){
-        reference=text.mid(1);
-        return 2;
-    }
-    if(text.startsWith('<')){
-        reference=text.mid(1);
-        return -2;
-    }
-    if(text.startsWith('=')){
-        reference=text.mid(1);
-        return 0;
-    }
-    if(text.startsWith("contains ")){
-        reference=text.mid(9);
-        return 10;
-    }
-    if(text.startsWith("!contains ")){
-        reference=text.mid(10);
-        return 11;
+    cf.compiledQuery.reset();
+    cf.result.reset();
+    if(cf.query.isEmpty()) return;
+    QSharedPointer<FilterQuery> query(new FilterQuery);
+    query->compile(cf.query,getDataType(cf.column));
+    cf.compiledQuery=query;
+}
+
+/*!
+ * \brief checked values of value picker in header menu changed
+ * Replaces the filter of the column by the checked values.
+ */
+void MainWindow::valuePickerChanged()
+{
+    ValuePicker *picker=qobject_cast<ValuePicker*>(sender());
+    if(!picker) return;
+    int column=picker->column();
+    int cfi=getColumnFilter(column);
+    if(picker->allChecked()){
+        //remove filter if all is allowed
+        if(cfi>=0){
+            m_columnFilters.removeAt(cfi);
+            updateColBackground(column,false);
+            updateFilteredTable();
+        }
+        return;
     }
-    if(text.startsWith("regex ")){
-        reference=text.mid(6);
-        return 12;
+    if(cfi<0){
+        ColumnFilter cf;
+        cf.column=column;
+        m_columnFilters.append(cf);
+        cfi=m_columnFilters.size()-1;
     }
-    if(text.startsWith("!regex ")){
-        reference=text.mid(7);
-        return 13;
+    ColumnFilter &cf=m_columnFilters[cfi];
+    cf.allowedValues=picker->checkedValues();
+    cf.query.clear();
+    cf.compiledQuery.reset();
+    cf.result.reset();
+    if(cf.allowedValues.isEmpty()){
+        updateColBackgroundOff(column);
+    }else{
+        updateColBackground(column,true);
     }
-    return -1000; // unknown
+    updateFilteredTable();
 }
 /*!
  * \brief called when plot style is changed
@@ -1640,7 +2115,7 @@ void MainWindow::plotStyleChanged()
  */
 QDebug operator<< (QDebug d, const QList<LoopIteration>& dt) {
     foreach(const LoopIteration &lit,dt){
-        d << lit.value << '/' << lit.indices;
+        d << lit.value << '/' << lit.indices.rows();
     }
     return d;
 }
@@ -1650,18 +2125,15 @@ QDebug operator<< (QDebug d, const QList<LoopIteration>& dt) {
 void MainWindow::test()
 {
     if(m_csv.isEmpty()) return;
-    std::vector<bool> providedIndices(m_csv[0].size());
-    for(int i=0;i<m_csv[0].size();++i){
-        providedIndices[i]=true;
-    }
+    RowSelection providedIndices(m_csv[0].size(),true);
     QStringList vals=getUniqueValues("x",providedIndices);
     qDebug()<<"x"<<vals;
     vals=getUniqueValues("s",providedIndices);
     qDebug()<<"s"<<vals;
-    std::vector<bool> indices=filterIndices("s","2",providedIndices);
-    qDebug()<<"s indices"<<indices;
+    RowSelection indices=filterIndices("s","2",providedIndices);
+    qDebug()<<"s indices"<<indices.rows();
     indices=filterIndices("x","0.2",providedIndices);
-    qDebug()<<"x inices"<<indices;
+    qDebug()<<"x inices"<<indices.rows();
     QStringList vars;
     vars<<"s";
     QList<LoopIteration> lits=groupBy(vars);
@@ -1675,33 +2147,458 @@ void MainWindow::test()
     qDebug()<<"by none:"<<lits;
 }
 /*!
- * \brief copy content of cell to clipboard
- * For now, copies only first cell
+ * \brief show filter cache statistics and ask for memory budget
+ */
+void MainWindow::filterCacheSettings()
+{
+    const qint64 mib=1024*1024;
+    const QString info=tr("%1 entries, %2 MiB used\nhits: %3, misses: %4\n\nMemory budget (MiB):")
+            .arg(m_filterCache.entryCount())
+            .arg(double(m_filterCache.memoryUsage())/mib,0,'f',1)
+            .arg(m_filterCache.hits())
+            .arg(m_filterCache.misses());
+    bool ok;
+    int budget=QInputDialog::getInt(this,tr("Filter cache"),info,int(m_filterCache.budget()/mib),0,1024*1024,64,&ok);
+    if(!ok) return;
+    m_filterCache.setBudget(budget*mib);
+}
+/*!
+ * \brief ask for maximum number of threads used for filtering, search and statistics
+ */
+void MainWindow::threadSettings()
+{
+    const int cores=QThread::idealThreadCount();
+    bool ok;
+    int threads=QInputDialog::getInt(this,tr("Threads"),tr("Maximum number of threads (0: all %1 cores):").arg(cores),threadLimit(),0,cores,1,&ok);
+    if(!ok) return;
+    setMaxThreads(threads);
+}
+/*!
+ * \brief ask for number of series above which plotting asks first
+ */
+void MainWindow::seriesLimitSettings()
+{
+    bool ok;
+    int limit=QInputDialog::getInt(this,tr("Series limit"),tr("Ask before plotting more series than (0: never ask):"),m_maxSeries,0,1000000,100,&ok);
+    if(!ok) return;
+    m_maxSeries=limit;
+}
+/*!
+ * \brief upper estimate of number of groups for sweep vars
+ * Product of the (estimated) distinct values per var, bins for binned vars,
+ * limited by the number of visible rows. Cached per column, so this is cheap.
+ * \param vars
+ * \return
+ */
+double MainWindow::estimateGroupCount(const QStringList &vars)
+{
+    if(m_csv.isEmpty()) return 0;
+    double groups=1;
+    for(const QString &var:vars){
+        int index=getIndex(var);
+        if(index<0) return 0;
+        const ColumnDictionary *bins=m_store.binning(index,m_binning.value(var));
+        groups*= bins ? bins->values.size() : m_store.distinctEstimate(index);
+    }
+    const qsizetype rows= m_visibleRows.isEmpty() ? m_csv[0].size() : m_visibleRows.count();
+    return qMin(groups,double(rows));
+}
+/*!
+ * \brief reduce groups to the ones with most rows
+ * Order of the remaining groups is kept.
+ * \param lits
+ * \param count
+ * \param byBand keep whole bands (consecutive groups which only differ in the last sweep var) instead of groups
+ */
+void MainWindow::keepLargestGroups(QList<LoopIteration> &lits, int count, bool byBand)
+{
+    // spans of consecutive groups which are kept or dropped together
+    std::vector<int> starts=groupSpans(lits,byBand);
+    if(int(starts.size())<=count) return;
+    starts.push_back(lits.size());
+    std::vector<std::pair<qsizetype,int>> sizes; // (rows,span)
+    sizes.reserve(starts.size()-1);
+    for(std::size_t span=0;span+1<starts.size();++span){
+        qsizetype rows=0;
+        for(int i=starts[span];i<starts[span+1];++i){
+            rows+=lits.at(i).indices.count();
+        }
+        sizes.emplace_back(rows,int(span));
+    }
+    std::stable_sort(sizes.begin(),sizes.end(),[](const std::pair<qsizetype,int> &a,const std::pair<qsizetype,int> &b){
+        return a.first>b.first;
+    });
+    std::vector<int> keep;
+    for(int i=0;i<count;++i){
+        keep.push_back(sizes[i].second);
+    }
+    std::sort(keep.begin(),keep.end());
+    QList<LoopIteration> result;
+    for(int span:keep){
+        for(int i=starts[span];i<starts[span+1];++i){
+            result<<lits.at(i);
+        }
+    }
+    lits=result;
+}
+/*!
+ * \brief measure throughput of filter comparison kernels on synthetic data
+ * Results are shown in a message box.
+ */
+void MainWindow::benchmarkFilter()
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const qsizetype count=1<<24;
+    std::vector<double> values(count);
+    for(qsizetype i=0;i<count;++i){
+        values[i]=double((i*2654435761u)%1000)/10.; // spread 0..99.9
+    }
+    values[count/3]=qQNaN();
+    RowSelection result(count);
+    const char *names[]={">",">=","=","<=","<","!="};
+    QStringList lines;
+    lines<<QString("kernels: %1").arg(kernelInstructionSet());
+    for(int op=FilterNode::OP_GT;op<=FilterNode::OP_NE;++op){
+        QElapsedTimer timer;
+        timer.start();
+        const int repeat=10;
+        for(int r=0;r<repeat;++r){
+            compareKernel(values.data(),count,static_cast<FilterNode::Op>(op),50.,result.words());
+        }
+        const double seconds=timer.nsecsElapsed()*1e-9;
+        const double gbs=double(count)*sizeof(double)*repeat/seconds*1e-9;
+        const QString line=QString("%1 50: %2 rows pass, %3 GB/s").arg(names[op]).arg(result.count()).arg(gbs,0,'f',2);
+        lines<<line;
+    }
+    QApplication::restoreOverrideCursor();
+    QMessageBox::information(this,tr("Filter benchmark"),lines.join("\n"));
+}
+/*!
+ * \brief append text as utf-8 to buffer
+ * Plain ascii (the usual case for numbers) is copied without temporary strings.
+ * \param buffer
+ * \param text
+ */
+static inline void appendUtf8(QByteArray &buffer,const QString &text)
+{
+    const QChar *chars=text.constData();
+    const qsizetype n=text.size();
+    for(qsizetype i=0;i<n;++i){
+        if(chars[i].unicode()>=0x80){
+            buffer.append(text.toUtf8());
+            return;
+        }
+    }
+    const qsizetype offset=buffer.size();
+    buffer.resize(offset+n);
+    char *out=buffer.data()+offset;
+    for(qsizetype i=0;i<n;++i){
+        out[i]=static_cast<char>(chars[i].unicode());
+    }
+}
+/*!
+ * \brief copy content of selected cells to clipboard
+ * Tab separated, rows separated by newline.
+ * Large selections can be written to a file instead.
  */
 void MainWindow::copyCell()
 {
-    auto items=tableWidget->selectedItems();
-    if(!items.isEmpty()){
-        QString txt;
-        int row=-1;
-        for(auto item:items){
-            if(txt.isEmpty()){
-                txt=item->text();
-            }else{
-                if(row!=item->row()){
-                    txt.append("\n");
-                    txt.append(item->text());
+    const QItemSelection selection=tableView->selectionModel()->selection();
+    if(selection.isEmpty()) return;
+    qint64 cells=0;
+    for(const QItemSelectionRange &range:selection){
+        cells+=qint64(range.width())*range.height();
+    }
+    if(cells>copyToFileThreshold){
+        QMessageBox::StandardButton button=QMessageBox::question(this,tr("Copy"),
+                tr("%1 cells are selected.\nExport them to a file instead of the clipboard?").arg(cells),
+                QMessageBox::Yes|QMessageBox::No|QMessageBox::Cancel);
+        if(button==QMessageBox::Cancel) return;
+        if(button==QMessageBox::Yes){
+            QString fileName = QFileDialog::getSaveFileName(this,
+                tr("Export selection"), m_fileName+".tsv", tr("TSV File (*.tsv)"));
+            if(fileName.isEmpty()) return;
+            QFile saveFile(fileName);
+            if (!saveFile.open(QIODevice::WriteOnly)) {
+                qWarning("Couldn't open save file.");
+                return;
+            }
+            QByteArray buffer;
+            writeSelection(selection,buffer,&saveFile);
+            return;
+        }
+    }
+    QByteArray buffer;
+    writeSelection(selection,buffer);
+    QMimeData *mimeData=new QMimeData;
+    mimeData->setData("text/plain",buffer);
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setMimeData(mimeData);
+}
+/*!
+ * \brief serialize selected cells as tab separated values (utf-8)
+ * Rows are the union of selected rows, columns the union of selected columns.
+ * Cells which are not selected stay empty.
+ * Buffer is presized from the cell lengths. If device is given, buffer is flushed to it in chunks.
+ * \param selection ranges in view coordinates
+ * \param buffer
+ * \param device
+ */
+void MainWindow::writeSelection(const QItemSelection &selection, QByteArray &buffer, QIODevice *device)
+{
+    const QList<int> columns=selectedColumns();
+    // merged row intervals
+    QList<QPair<int,int>> intervals;
+    for(const QItemSelectionRange &range:selection){
+        intervals.append(qMakePair(range.top(),range.bottom()));
+    }
+    std::sort(intervals.begin(),intervals.end());
+    QList<QPair<int,int>> rows;
+    for(const auto &interval:intervals){
+        if(!rows.isEmpty() && interval.first<=rows.last().second+1){
+            rows.last().second=qMax(rows.last().second,interval.second);
+        }else{
+            rows.append(interval);
+        }
+    }
+    // ranges covering each column, only needed if not a simple block
+    const bool singleRange=selection.size()==1;
+    QVector<QList<QItemSelectionRange>> columnRanges(columns.size());
+    if(!singleRange){
+        for(int k=0;k<columns.size();++k){
+            for(const QItemSelectionRange &range:selection){
+                if(columns[k]>=range.left() && columns[k]<=range.right()){
+                    columnRanges[k].append(range);
+                }
+            }
+        }
+    }
+    QVector<bool> formatted(columns.size());
+    for(int k=0;k<columns.size();++k){
+        formatted[k]=m_model->displayFormat(columns[k])!=CsvTableModel::FMT_DEFAULT;
+    }
+    auto isSelected=[&](int k,int row){
+        if(singleRange) return true;
+        for(const QItemSelectionRange &range:columnRanges[k]){
+            if(row>=range.top() && row<=range.bottom()) return true;
+        }
+        return false;
+    };
+    // presize
+    if(device){
+        buffer.reserve(copyChunkSize+4096);
+    }else{
+        qint64 size=0;
+        for(const auto &interval:rows){
+            for(int row=interval.first;row<=interval.second;++row){
+                const int dataRow=m_model->sourceRow(row);
+                for(int k=0;k<columns.size();++k){
+                    if(isSelected(k,row)){
+                        size+=m_csv.at(columns[k]).at(dataRow).size();
+                    }
+                    size+=1; // separator
+                }
+            }
+        }
+        buffer.reserve(size);
+    }
+    bool firstRow=true;
+    for(const auto &interval:rows){
+        for(int row=interval.first;row<=interval.second;++row){
+            if(!firstRow){
+                buffer.append('\n');
+            }
+            firstRow=false;
+            const int dataRow=m_model->sourceRow(row);
+            for(int k=0;k<columns.size();++k){
+                if(k>0){
+                    buffer.append('\t');
+                }
+                if(!isSelected(k,row)) continue;
+                const int column=columns[k];
+                const QString &cell=m_csv.at(column).at(dataRow);
+                if(formatted[k]){
+                    appendUtf8(buffer,m_model->formatValue(column,cell));
                 }else{
-                    txt.append("\t");
-                    txt.append(item->text());
+                    appendUtf8(buffer,cell);
                 }
             }
-            row=item->row();
+            if(device && buffer.size()>=copyChunkSize){
+                device->write(buffer);
+                buffer.resize(0);
+            }
         }
-
-        QClipboard *clipboard = QGuiApplication::clipboard();
-        clipboard->setText(txt);
     }
+    if(device){
+        device->write(buffer);
+        buffer.resize(0);
+    }
+}
+/*!
+ * \brief open find dialog
+ * Search runs on the column data in background.
+ */
+void MainWindow::find()
+{
+    if(!m_findDialog){
+        m_findDialog=new FindDialog(this);
+        m_findDialog->setSource(&m_columns,&m_csv,&m_store);
+        connect(m_findDialog,&FindDialog::hitActivated,this,&MainWindow::showFindHit);
+    }
+    m_findDialog->setSelectedColumns(selectedColumns());
+    m_findDialog->show();
+    m_findDialog->raise();
+    m_findDialog->activateWindow();
+}
+/*!
+ * \brief move table view to found cell
+ * \param row row in data
+ * \param column
+ */
+void MainWindow::showFindHit(int row, int column)
+{
+    if(tabWidget->currentIndex()!=0){
+        tabWidget->setCurrentIndex(0);
+    }
+    int viewRow=m_model->viewRow(row);
+    if(viewRow<0){
+        statusBar()->showMessage(tr("row %1 is hidden by filter").arg(row+1),5000);
+        return;
+    }
+    if(tableView->isColumnHidden(column)){
+        tableView->showColumn(column);
+        recomputeSelectionStats();
+    }
+    QModelIndex index=m_model->index(viewRow,column);
+    tableView->setCurrentIndex(index);
+    tableView->scrollTo(index,QAbstractItemView::PositionAtCenter);
+}
+/*!
+ * \brief get columns which contain selected cells
+ * \return sorted list of columns
+ */
+QList<int> MainWindow::selectedColumns() const
+{
+    std::set<int> columns;
+    const QItemSelection selection=tableView->selectionModel()->selection();
+    for(const QItemSelectionRange &range:selection){
+        for(int column=range.left();column<=range.right();++column){
+            columns.insert(column);
+        }
+    }
+    return QList<int>(columns.begin(),columns.end());
+}
+/*!
+ * \brief update summary statistics of selected cells incrementally
+ * Only changed ranges are reduced. Removing cells which may hold min/max forces a full update.
+ * \param selected
+ * \param deselected
+ */
+void MainWindow::tableSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
+{
+    qint64 cells;
+    if(!deselected.isEmpty()){
+        RunningStats removed=selectionStats(deselected,cells);
+        if(removed.count>0 && (removed.min<=m_selectionStats.min || removed.max>=m_selectionStats.max)){
+            recomputeSelectionStats();
+            return;
+        }
+        m_selectionStats.remove(removed);
+        m_selectedCells-=cells;
+    }
+    m_selectionStats.merge(selectionStats(selected,cells));
+    m_selectedCells+=cells;
+    updateSelectionStatus();
+}
+/*!
+ * \brief reduce numeric columns over selection ranges
+ * Uses the cached number representation of int/float columns.
+ * Ranges may overlap (e.g. after ctrl-drag), so row intervals are merged per column first.
+ * Columns hidden by the column filter are left out.
+ * \param selection ranges in view coordinates
+ * \param cells number of selected cells
+ * \return
+ */
+RunningStats MainWindow::selectionStats(const QItemSelection &selection, qint64 &cells)
+{
+    RunningStats result;
+    cells=0;
+    std::map<int,std::vector<std::pair<int,int>>> intervals; // row intervals per column
+    for(const QItemSelectionRange &range:selection){
+        for(int column=range.left();column<=range.right();++column){
+            if(tableView->isColumnHidden(column)) continue;
+            intervals[column].emplace_back(range.top(),range.bottom());
+        }
+    }
+    const std::vector<int> *rowMap=m_model->rowMap();
+    for(auto &elem:intervals){
+        const int column=elem.first;
+        std::vector<std::pair<int,int>> &rows=elem.second;
+        std::sort(rows.begin(),rows.end());
+        const ColumnType type=m_store.type(column);
+        const bool numeric= type==COL_INT || type==COL_FLOAT;
+        const double *values= numeric ? m_store.numbers(column).data() : nullptr;
+        int top=rows.front().first;
+        int bottom=rows.front().second;
+        auto reduce=[&](){
+            const qsizetype count=bottom-top+1;
+            cells+=count;
+            if(!values) return;
+            if(rowMap){
+                result.merge(reduceStats(values,rowMap->data()+top,count));
+            }else{
+                result.merge(reduceStats(values+top,count));
+            }
+        };
+        for(const auto &interval:rows){
+            if(interval.first<=bottom+1){
+                bottom=qMax(bottom,interval.second);
+            }else{
+                reduce();
+                top=interval.first;
+                bottom=interval.second;
+            }
+        }
+        reduce();
+    }
+    return result;
+}
+/*!
+ * \brief reduce whole selection again, e.g. after columns were hidden or shown
+ */
+void MainWindow::recomputeSelectionStats()
+{
+    m_selectionStats=selectionStats(tableView->selectionModel()->selection(),m_selectedCells);
+    updateSelectionStatus();
+}
+/*!
+ * \brief clear selection statistics, e.g. after model reset
+ */
+void MainWindow::resetSelectionStats()
+{
+    m_selectionStats=RunningStats();
+    m_selectedCells=0;
+    updateSelectionStatus();
+}
+/*!
+ * \brief show selection statistics in status bar
+ */
+void MainWindow::updateSelectionStatus()
+{
+    if(m_selectedCells<2){
+        lblSelectionStats->clear();
+        return;
+    }
+    QString text=tr("count: %1").arg(m_selectedCells);
+    if(m_selectionStats.count>0){
+        text+=tr("  sum: %1  mean: %2  min: %3  max: %4  std: %5")
+                .arg(m_selectionStats.sum())
+                .arg(m_selectionStats.mean)
+                .arg(m_selectionStats.min)
+                .arg(m_selectionStats.max)
+                .arg(m_selectionStats.std());
+    }
+    lblSelectionStats->setText(text);
 }
 /*!
  * \brief copy header text to clipboard
@@ -1713,9 +2610,9 @@ void MainWindow::copyHeader()
     bool ok;
     int col=act->data().toInt(&ok);
     if(!ok){
-        auto items=tableWidget->selectedItems();
-        if(!items.isEmpty()){
-            col=tableWidget->column(items[0]);
+        QModelIndex index=tableView->selectionModel()->currentIndex();
+        if(index.isValid()){
+            col=index.column();
         }else{
             col=-1;
         }
@@ -1789,46 +2686,13 @@ void MainWindow::exportPlotImage()
 /*!
  * \brief check what data type one column consists of
  * String, int or float.
- * Result is cached as it does not change.
+ * Result is cached in column store as it does not change.
  * \param column
  * \return
  */
-MainWindow::ColumnType MainWindow::getDataType(int column)
+ColumnType MainWindow::getDataType(int column)
 {
-    bool ok=true;
-    if(m_columnType[column]==COL_UNKNOWN){
-        ColumnType result=COL_INT; // int -> float -> string
-        QRegularExpression reFloat("^\\s*[+-]?\\d+(\\.\\d+)?(e[+-]?\\d+)?$");
-        QRegularExpression reInt("^[+-]?\\d+$");
-        for(qsizetype row=0;row<m_csv[column].count();++row){
-            QString cell=m_csv[column].value(row).simplified().toLower();
-            if(cell.startsWith("0x")){
-                cell.mid(2).toULongLong(&ok);
-                if(ok) continue;
-                result=COL_STRING;
-                break;
-            }
-            if(cell.startsWith("0b")){
-                cell.mid(2).toULongLong(&ok);
-                if(ok) continue;
-                result=COL_STRING;
-                break;
-            }
-            if(result==COL_INT){
-                QRegularExpressionMatch match = reInt.match(cell);
-                ok = match.hasMatch();
-                if(ok) continue;
-                result=COL_FLOAT;
-            }
-            QRegularExpressionMatch match = reFloat.match(cell);
-            ok = match.hasMatch();
-            if(ok) continue;
-            result=COL_STRING;
-            break;
-        }
-        m_columnType[column]=result;
-    }
-    return m_columnType[column];
+    return m_store.type(column);
 }
 /*!
  * \brief check if data consists only of ints
@@ -1853,48 +2717,13 @@ bool MainWindow::isFloatOnlyData(int column)
 }
 /*!
  * \brief check if data consists only of positive floats
+ * Cached in column store.
  * \param column
  * \return
  */
 bool MainWindow::isPosFloatOnlyData(int column)
 {
-    bool ok=true;
-    QRegularExpression re("^\\d+(\\.\\d+)?(E[-]?\\d+)?");
-    for(qsizetype row=0;row<m_csv[column].count();++row){
-        QString cell=m_csv[column].value(row);
-        QRegularExpressionMatch match = re.match(cell);
-        ok = match.hasMatch();
-        if(!ok) break;
-    }
-    return ok;
-}
-/*!
- * \brief get maximum number of bits on all integer number in column
- * Maybe fail for negative numbers !!!!
- * \param column
- * \return
- */
-int MainWindow::getIntegerWidth(int column)
-{
-    int bits=0;
-    bool negative=false;
-    for(qsizetype row=0;row<m_csv[column].count();++row){
-        QString cell=m_csv[column].value(row);
-        bool ok;
-        qlonglong value=convertStringToLong(cell,ok);
-        if(!ok) break;
-        if(value<0){
-            // wild guessing from here
-            value=-value;
-            negative=true;
-        }
-        int k;
-        for(k=0;value!=0;++k){
-            value=value>>1;
-        }
-        if(k>bits) bits=k;
-    }
-    return !negative ? bits : bits+1;
+    return m_store.isNonNegative(column);
 }
 /*!
  * \brief show column in table as decimal coding
@@ -1903,60 +2732,66 @@ void MainWindow::showDecimal()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
-    bool ok;
-    for(qsizetype row=0;row<m_csv[column].count();++row){
-        QString cell=m_csv[column].value(row);
-        qulonglong value=convertStringToLong(cell,ok);
-        if(!ok) break;
-        QTableWidgetItem *item=tableWidget->item(row,column);
-        item->setText(QString("%1").arg(value,0));
-    }
-    tableWidget->resizeColumnToContents(column);
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_DECIMAL);
+    tableView->resizeColumnToContents(column);
 }
 /*!
  * \brief show column in table as binary coding
+ * Bit width is taken from column statistics
  */
 void MainWindow::showBinary()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
-    int bits=getIntegerWidth(column);
-    bool ok;
-    for(qsizetype row=0;row<m_csv[column].count();++row){
-        QString cell=m_csv[column].value(row);
-        qulonglong value=convertStringToLong(cell,ok);
-        if(value<0){
-            // 2er complement
-            value=(1<<bits)+value;
-        }
-        QTableWidgetItem *item=tableWidget->item(row,column);
-        item->setText(QString("0b%1").arg(value,bits,2,QChar('0')));
-        if(!ok) break;
-    }
-    tableWidget->resizeColumnToContents(column);
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_BINARY);
+    tableView->resizeColumnToContents(column);
 }
 /*!
  * \brief show column in table as hex coding
+ * Bit width is taken from column statistics
  */
 void MainWindow::showHex()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
-    int bits=getIntegerWidth(column);
-    int digits=bits/4 + (bits%4==0 ? 0 : 1);
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_HEX);
+    tableView->resizeColumnToContents(column);
+}
+/*!
+ * \brief show column in table in engineering notation (exponent multiple of 3)
+ */
+void MainWindow::showEngineering()
+{
+    QAction *act=qobject_cast<QAction*>(sender());
+    int column=act->data().toInt();
     bool ok;
-    for(qsizetype row=0;row<m_csv[column].count();++row){
-        QString cell=m_csv[column].value(row);
-        qulonglong value=convertStringToLong(cell,ok);
-        if(!ok) break;
-        if(value<0){
-            // 2er complement
-            value=(1<<bits)+value;
-        }
-        QTableWidgetItem *item=tableWidget->item(row,column);
-        item->setText(QString("0x%1").arg(value,digits,16,QChar('0')));
-    }
-    tableWidget->resizeColumnToContents(column);
+    int precision=QInputDialog::getInt(this,tr("Engineering format"),tr("Digits:"),3,0,15,1,&ok);
+    if(!ok) return;
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_ENGINEERING,precision);
+    tableView->resizeColumnToContents(column);
+}
+/*!
+ * \brief show column in table with fixed number of digits
+ */
+void MainWindow::showFixed()
+{
+    QAction *act=qobject_cast<QAction*>(sender());
+    int column=act->data().toInt();
+    bool ok;
+    int precision=QInputDialog::getInt(this,tr("Fixed format"),tr("Digits:"),3,0,15,1,&ok);
+    if(!ok) return;
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_FIXED,precision);
+    tableView->resizeColumnToContents(column);
+}
+/*!
+ * \brief show column as read from file
+ */
+void MainWindow::showDefault()
+{
+    QAction *act=qobject_cast<QAction*>(sender());
+    int column=act->data().toInt();
+    m_model->setDisplayFormat(column,CsvTableModel::FMT_DEFAULT);
+    tableView->resizeColumnToContents(column);
 }
 /*!
  * \brief convert column in table as float from dB20
@@ -1965,18 +2800,22 @@ void MainWindow::convertDB20Float()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
+    if(m_findDialog){
+        m_findDialog->stopSearch();
+    }
+    if(m_filterEditor){
+        m_filterEditor->stopEvaluation();
+    }
     bool ok;
     for(qsizetype row=0;row<m_csv[column].count();++row){
         QString cell=m_csv[column].value(row);
         double value=cell.toDouble(&ok);
         if(!ok) break;
         value=pow(10,value/20);
-        QTableWidgetItem *item=tableWidget->item(row,column);
         cell=QString("%1").arg(value);
         m_csv[column][row]=cell;
-        item->setText(cell);
     }
-    tableWidget->resizeColumnToContents(column);
+    columnDataChanged(column);
 }
 /*!
  * \brief convert column in table as float from dB10
@@ -1985,18 +2824,22 @@ void MainWindow::convertDB10Float()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
+    if(m_findDialog){
+        m_findDialog->stopSearch();
+    }
+    if(m_filterEditor){
+        m_filterEditor->stopEvaluation();
+    }
     bool ok;
     for(qsizetype row=0;row<m_csv[column].count();++row){
         QString cell=m_csv[column].value(row);
         double value=cell.toDouble(&ok);
         if(!ok) break;
         value=pow(10,value/10);
-        QTableWidgetItem *item=tableWidget->item(row,column);
         cell=QString("%1").arg(value);
         m_csv[column][row]=cell;
-        item->setText(cell);
     }
-    tableWidget->resizeColumnToContents(column);
+    columnDataChanged(column);
 }
 /*!
  * \brief convert column in table as dB20 from pos. float
@@ -2005,18 +2848,22 @@ void MainWindow::convertFloatDB20()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
+    if(m_findDialog){
+        m_findDialog->stopSearch();
+    }
+    if(m_filterEditor){
+        m_filterEditor->stopEvaluation();
+    }
     bool ok;
     for(qsizetype row=0;row<m_csv[column].count();++row){
         QString cell=m_csv[column].value(row);
         double value=cell.toDouble(&ok);
         if(!ok) break;
         value=log10(value)*20;
-        QTableWidgetItem *item=tableWidget->item(row,column);
         cell=QString("%1").arg(value);
         m_csv[column][row]=cell;
-        item->setText(cell);
     }
-    tableWidget->resizeColumnToContents(column);
+    columnDataChanged(column);
 }
 /*!
  * \brief convert column in table as dB10 from pos. float
@@ -2025,18 +2872,50 @@ void MainWindow::convertFloatDB10()
 {
     QAction *act=qobject_cast<QAction*>(sender());
     int column=act->data().toInt();
+    if(m_findDialog){
+        m_findDialog->stopSearch();
+    }
+    if(m_filterEditor){
+        m_filterEditor->stopEvaluation();
+    }
     bool ok;
     for(qsizetype row=0;row<m_csv[column].count();++row){
         QString cell=m_csv[column].value(row);
         double value=cell.toDouble(&ok);
         if(!ok) break;
         value=log10(value)*10;
-        QTableWidgetItem *item=tableWidget->item(row,column);
         cell=QString("%1").arg(value);
         m_csv[column][row]=cell;
-        item->setText(cell);
     }
-    tableWidget->resizeColumnToContents(column);
+    columnDataChanged(column);
+}
+/*!
+ * \brief drop everything derived from the content of column
+ * Cached column data is recomputed on next use, filters on the column are evaluated again.
+ * \param column
+ */
+void MainWindow::columnDataChanged(int column)
+{
+    m_store.invalidate(column);
+    bool filtered=false;
+    int cfi=getColumnFilter(column);
+    if(cfi>=0){
+        compileColumnFilter(m_columnFilters[cfi]); // column type may have changed
+        filtered=true;
+    }
+    if(m_query && m_query->columns().contains(column)){
+        m_queryResult.reset();
+        compileQuery();
+        filtered=true;
+    }
+    m_model->columnChanged(column);
+    pivotView->invalidate();
+    tableView->resizeColumnToContents(column);
+    if(filtered){
+        updateFilteredTable(); // also restarts the filter editor
+    }else if(m_filterEditor && m_filterEditor->isVisible()){
+        m_filterEditor->setContext(rowsPassingOtherFilters(m_filterEditor->column()));
+    }
 }
 /*!
  * \brief convert String to long
@@ -2047,17 +2926,7 @@ void MainWindow::convertFloatDB10()
  */
 qlonglong MainWindow::convertStringToLong(QString text, bool &ok)
 {
-    qlonglong value;
-    if(text.startsWith("0b")){
-        value=text.mid(2).toLongLong(&ok,2);
-    }else{
-        if(text.startsWith("0x")){
-            value=text.mid(2).toLongLong(&ok,16);
-        }else{
-            value=text.toLongLong(&ok);
-        }
-    }
-    return value;
+    return ColumnStore::toLong(text,ok);
 }
 /*!
  * \brief get column number from header name
@@ -2066,8 +2935,7 @@ qlonglong MainWindow::convertStringToLong(QString text, bool &ok)
  */
 int MainWindow::getIndex(const QString &name)
 {
-    int result=m_columns.indexOf(name);
-    return result;
+    return m_columnIndex.value(name,-1);
 }
 /*!
  * \brief check if specific column has a filter
@@ -2102,35 +2970,38 @@ int MainWindow::getColumnFilter(int column) const
  * \param indices
  * \return list of values
  */
-QStringList MainWindow::getUniqueValues(const QString &var, const std::vector<bool> &indices)
+QStringList MainWindow::getUniqueValues(const QString &var, const RowSelection &indices)
 {
     int index=getIndex(var);
     QStringList result;
     if(index<0) return result;
-    for(std::size_t i=0;i<indices.size();++i){
-        if(indices[i]){
-            result<<m_csv[index][i];
-        }
-    }
+    const QStringList &column=m_csv[index];
+    indices.forEach([&](qsizetype i){
+        result<<column[i];
+    });
     result.removeDuplicates();
     return result;
 }
 /*!
  * \brief filter providedIndices for all values where var contains value
+ * Only selected rows are visited, the result is stored compactly (see RowSelection::optimize).
  * \param var
  * \param value
  * \param providedIndices
  * \return
  */
-std::vector<bool> MainWindow::filterIndices(const QString &var, const QString &value, const std::vector<bool> &providedIndices)
+RowSelection MainWindow::filterIndices(const QString &var, const QString &value, const RowSelection &providedIndices)
 {
     int index=getIndex(var);
-    std::vector<bool> result=providedIndices;
-    for(std::size_t i=0;i<result.size();++i){
-        if(m_csv[index][i]!=value){
-            result[i]=false;
+    const QStringList &column=m_csv[index];
+    std::vector<int> rows;
+    providedIndices.forEach([&](qsizetype i){
+        if(column[i]==value){
+            rows.push_back(int(i));
         }
-    }
+    });
+    RowSelection result=RowSelection::fromRows(providedIndices.size(),std::move(rows));
+    result.optimize();
     return result;
 }
 /*!
@@ -2176,35 +3047,48 @@ QString MainWindow::unquote(const QString &text) const
 }
 /*!
  * \brief like groupBy in pandas.
- * Produces list of indices which belong to one sweep iteration
+ * Produces list of indices which belong to one sweep iteration.
+ * All rows are grouped in one pass (see RowGrouping), each group keeps a compact list of its rows.
  * \param sweepVar, last is x axxis
  * \return list of list of indices
  */
-QList<LoopIteration> MainWindow::groupBy(QStringList sweepVar,std::vector<bool> providedIndices)
+QList<LoopIteration> MainWindow::groupBy(QStringList sweepVar,const RowSelection &providedIndices)
 {
     QList<LoopIteration> result;
-    if(providedIndices.size()==0){
-        // fill from 0 to size(csv)-1
-        int sz=m_csv[0].size();
-        providedIndices.resize(sz);
-        for(int i=0;i<m_csv[0].size();++i){
-            providedIndices[i]=true;
-        }
-    }
-    if(!sweepVar.isEmpty()){
-        QString var=sweepVar.takeFirst();
-        QStringList values=getUniqueValues(var,providedIndices);
-        for(const QString &value:values){
-            std::vector<bool> indices=filterIndices(var,value,providedIndices);
-            QList<LoopIteration>groupedResult=groupBy(sweepVar,indices);
-            for(LoopIteration &lit:groupedResult){
-                lit.value.prepend(var+"="+value+";");
-            }
-            result.append(groupedResult);
+    if(m_csv.isEmpty() || m_csv[0].isEmpty()) return result;
+    const qsizetype rows=m_csv[0].size();
+    QList<int> columns;
+    QVector<const ColumnDictionary*> binned;
+    for(const QString &var:sweepVar){
+        int index=getIndex(var);
+        if(index<0) return result;
+        columns<<index;
+        const BinSpec spec=m_binning.value(var);
+        const ColumnDictionary *bins=m_store.binning(index,spec);
+        if(spec.isActive() && !bins){
+            statusBar()->showMessage(tr("%1 can not be binned (not numeric or too many bins), grouped by value").arg(var),5000);
         }
+        binned<<bins;
+    }
+    RowGrouping grouping;
+    if(providedIndices.isEmpty()){
+        // all rows
+        grouping.compute(m_csv,m_store,columns,RowSelection(rows,true),binned);
     }else{
+        grouping.compute(m_csv,m_store,columns,providedIndices,binned);
+    }
+    for(int group=0;group<grouping.groupCount();++group){
         LoopIteration lit;
-        lit.indices=providedIndices;
+        const QStringList values=grouping.values(group);
+        for(int i=0;i<values.size();++i){
+            if(i==values.size()-1){
+                lit.band=lit.value;
+            }
+            lit.value+=sweepVar.at(i)+"="+values.at(i)+";";
+        }
+        lit.bandValues=values.mid(0,values.size()-1);
+        lit.indices=RowSelection::fromRows(rows,grouping.takeRows(group));
+        lit.indices.optimize();
         result<<lit;
     }
     return result;
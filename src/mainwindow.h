@@ -2,26 +2,41 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTableWidget>
+#include <QTableView>
 #include <QChartView>
 #include <QListWidget>
 #include <QLineEdit>
+#include <QLabel>
+#include <QTimer>
+#include <QHash>
+#include <QIODevice>
+#include <QSharedPointer>
 #include "zoomablechartview.h"
+#include "columnstore.h"
+#include "csvtablemodel.h"
+#include "finddialog.h"
+#include "filtereditor.h"
+#include "statistics.h"
+#include "filterquery.h"
+#include "rowselection.h"
+#include "filtercache.h"
+#include "queryexpression.h"
+#include "aggregation.h"
+#include "pivotview.h"
 
 struct LoopIteration{
-    QString value;
-    std::vector<bool> indices;
+    QString value; // "var=value;" per sweep var
+    QString band; // value without the last sweep var
+    QStringList bandValues; // values of all but the last sweep var, equal for the groups of one band
+    RowSelection indices;
 };
 
 struct ColumnFilter{
     int column;
     QStringList allowedValues;
     QString query;
-};
-
-struct Query{
-    QString query;
-    bool connectAnd=true;
+    QSharedPointer<FilterQuery> compiledQuery;
+    QSharedPointer<RowSelection> result; // cached rows passing this filter, null when it needs to be evaluated
 };
 
 class MainWindow : public QMainWindow
@@ -33,7 +48,6 @@ public:
     ~MainWindow();
 
 protected:
-    enum ColumnType {COL_UNKNOWN,COL_STRING,COL_FLOAT,COL_INT};
     void setupMenus();
     void setupGUI();
     void closeEvent(QCloseEvent *event);
@@ -51,12 +65,16 @@ protected:
     void updateSweepGUI();
     void updateSweeps(bool filterChecked=true);
     void plotSelected();
-    void addSeriesToChart(const int index_x, const QStringList &vars, const QString &yn, bool multiPlot);
-    void addLineSeriesToChart(const int index_x, const QStringList &vars, const QString &yn, bool multiPlot);
-    void addBarSeriesToChart(const int index_x, const QStringList &vars, const QString &yn, bool multiPlot);
+    void addSeriesToChart(const int index_x, const QList<LoopIteration> &lits, const QString &yn, bool multiPlot);
+    void addLineSeriesToChart(const int index_x, const QList<LoopIteration> &lits, const QString &yn, bool multiPlot);
+    void addEnvelopeSeriesToChart(const QList<LoopIteration> &lits, const std::vector<QList<QPointF>> &points, const QString &yName, bool multiPlot);
+    void addBarSeriesToChart(const int index_x, const QList<LoopIteration> &lits, const QString &yn, bool multiPlot);
     void tabChanged(int index);
     void headerMenuRequested(QPoint pt);
     void addSweepVar();
+    void sweepMenuRequested(QPoint pt);
+    void setBinning(const QString &var,BinSpec::Mode mode);
+    void updateSweepItem(QListWidgetItem *item);
     void deleteVar();
     void addPlotVar();
     void zoomAreaMode();
@@ -84,30 +102,57 @@ protected:
     void filterCheckedToggled(bool checked);
     void filterPlotToggled(bool checked);
     void filterTextChanged(const QString &text);
+    void applyColumnNameFilter();
     void columnShowAll();
     void columnShowNone();
     void columnFilter();
+    void applyColumnFilter(int column,const QString &query);
+    RowSelection rowsPassingOtherFilters(int column) const;
     void updateFilteredTable();
     void updateColBackground(int col,bool filtered=false);
     void updateColBackgroundOff(int col);
-    void filterRowsForColumnValues(ColumnFilter cf);
-    void filterElementChanged(bool checked);
-    bool parseQuery(const QString &text,const QString &data,const ColumnType col_type=COL_STRING);
-    int determineOperator(const QString &text,QString &reference);
+    void filterRowsForColumnValues(const ColumnFilter &cf,RowSelection &visible);
+    void compileColumnFilter(ColumnFilter &cf);
+    void columnDataChanged(int column);
+    bool compileQuery();
+    void applyQuery();
+    QString filterCacheKey(const ColumnFilter &cf) const;
+    void valuePickerChanged();
     void plotStyleChanged();
+    void aggregationChanged();
+    void envelopeChanged();
+    void pivotFromSweeps();
+    void sortXChanged(bool checked);
     void test();
+    void benchmarkFilter();
     void copyCell();
+    void writeSelection(const QItemSelection &selection,QByteArray &buffer,QIODevice *device=nullptr);
     void copyHeader();
+    void find();
+    void filterCacheSettings();
+    void threadSettings();
+    void seriesLimitSettings();
+    double estimateGroupCount(const QStringList &vars);
+    void keepLargestGroups(QList<LoopIteration> &lits,int count,bool byBand=false);
+    void showFindHit(int row,int column);
+    QList<int> selectedColumns() const;
+    void tableSelectionChanged(const QItemSelection &selected,const QItemSelection &deselected);
+    RunningStats selectionStats(const QItemSelection &selection,qint64 &cells);
+    void resetSelectionStats();
+    void recomputeSelectionStats();
+    void updateSelectionStatus();
     void copyPlotToClipboard();
     void exportPlotImage();
     ColumnType getDataType(int column);
     bool isIntOnlyData(int column);
     bool isFloatOnlyData(int column);
     bool isPosFloatOnlyData(int column);
-    int getIntegerWidth(int column);
     void showDecimal();
     void showBinary();
     void showHex();
+    void showEngineering();
+    void showFixed();
+    void showDefault();
     void convertDB20Float();
     void convertDB10Float();
     void convertFloatDB20();
@@ -116,14 +161,12 @@ protected:
     int getIndex(const QString &name);
     bool hasColumnFilter(int column) const;
     int getColumnFilter(int column) const;
-    QStringList getUniqueValues(const QString &var,const std::vector<bool> &indices);
-    std::vector<bool> filterIndices(const QString &var,const QString &value,const std::vector<bool> &providedIndices);
+    QStringList getUniqueValues(const QString &var,const RowSelection &indices);
+    RowSelection filterIndices(const QString &var,const QString &value,const RowSelection &providedIndices);
     QStringList splitAtComma(const QString &line) const;
     QString unquote(const QString &text) const;
 
-    QList<LoopIteration> groupBy(QStringList sweepVar,std::vector<bool> providedIndices=std::vector<bool>() );
-    QList<QPointF> getPoints(const int index_x,const int index_y,const LoopIteration &lit);
-    QList<QPointF> averagePointSeries(const QList<QPointF> &points);
+    QList<LoopIteration> groupBy(QStringList sweepVar,const RowSelection &providedIndices=RowSelection() );
 
 private:
     QMenu *m_fileMenu;
@@ -131,25 +174,33 @@ private:
     QMenu *m_editMenu;
     QMenu *m_recentFilesMenu,*m_recentTemplatesMenu;
     QMenu *m_plotTypeMenu;
+    QMenu *m_aggregationMenu;
+    QMenu *m_envelopeMenu;
 
     QAction *m_openAct;
     QAction *m_reloadAct;
     QAction *m_exitAct;
     QAction *m_plotAct;
     QAction *m_logxAct,*m_logyAct;
-    QAction *m_lineSeriesAveragedAct;
 
     QActionGroup *m_plotTypeActionGroup;
 
     QTabWidget *tabWidget;
-    QTableWidget *tableWidget;
+    QTableView *tableView;
+    CsvTableModel *m_model;
+    FindDialog *m_findDialog;
+    FilterEditor *m_filterEditor;
     ZoomableChartView *chartView;
+    PivotView *pivotView;
 
     QListWidget *lstSweeps;
     QListWidget *lstData;
 
     QToolButton *btFilter,*btFilterPlot,*btFilterChecked,*btRegExp;
     QLineEdit *leFilterText;
+    QLineEdit *leQuery;
+    QLabel *lblSelectionStats;
+    QTimer *m_filterTimer;
 
     QString m_fileName;
 
@@ -157,12 +208,23 @@ private:
     QChart::ChartTheme m_chartTheme;
 
     QStringList m_columns;
+    QHash<QString,int> m_columnIndex;
     QVector<QStringList> m_csv;
-    QVector<ColumnType> m_columnType;
+    ColumnStore m_store;
     QStringList m_sweeps,m_plotValues;
+    QHash<QString,BinSpec> m_binning; // per sweep var
+    int m_maxSeries; // ask before plotting more series, 0: never
+    AggregationSpec m_aggregation; // of y per x in line plots
+    EnvelopeSpec m_envelope; // band across series of last sweep var in line plots
+    bool m_sortX; // sort points of each series by x in line plots
 
     QList<ColumnFilter> m_columnFilters;
-    std::vector<bool>m_visibleRows;
+    QSharedPointer<QueryExpression> m_query; // query bar, null if empty
+    QSharedPointer<RowSelection> m_queryResult; // null when it needs to be evaluated
+    FilterCache m_filterCache;
+    RowSelection m_visibleRows;
+    RunningStats m_selectionStats;
+    qint64 m_selectedCells;
     bool m_logx,m_logy;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,82 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "parallel.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <atomic>
+
+static std::atomic<int> s_maxThreads{0};
+
+/*!
+ * \brief process range [0,count) in blocks of blockSize on all available threads
+ * Blocks are handed out one by one, so fast threads take over the remaining work of slow ones.
+ * The calling thread takes part in the work. Helper threads are only used if the global thread pool
+ * has free capacity, so nested calls can not dead-lock.
+ * \param count
+ * \param blockSize
+ * \param fn called with [begin,end) of one block
+ */
+void parallelFor(qsizetype count, qsizetype blockSize, const std::function<void (qsizetype, qsizetype)> &fn)
+{
+    if(count<=0) return;
+    if(blockSize<1) blockSize=1;
+    const qsizetype blocks=(count+blockSize-1)/blockSize;
+    std::atomic<qsizetype> next{0};
+    auto work=[&](){
+        qsizetype block;
+        while((block=next.fetch_add(1))<blocks){
+            const qsizetype begin=block*blockSize;
+            fn(begin,qMin(count,begin+blockSize));
+        }
+    };
+    const int threads=static_cast<int>(qMin<qsizetype>(maxThreads(),blocks));
+    QSemaphore done;
+    int started=0;
+    QThreadPool *pool=QThreadPool::globalInstance();
+    for(int i=1;i<threads;++i){
+        if(!pool->tryStart([&work,&done](){
+            work();
+            done.release();
+        })){
+            break;
+        }
+        ++started;
+    }
+    work();
+    done.acquire(started);
+}
+/*!
+ * \brief number of threads used by parallelFor
+ * \return
+ */
+int maxThreads()
+{
+    const int ideal=qMax(1,QThread::idealThreadCount());
+    const int limit=s_maxThreads.load();
+    if(limit>0) return qMin(limit,ideal);
+    return ideal;
+}
+/*!
+ * \brief limit number of threads, 0 uses all cores
+ * \param threads
+ */
+void setMaxThreads(int threads)
+{
+    s_maxThreads=qMax(0,threads);
+}
+/*!
+ * \brief limit set by setMaxThreads
+ * \return 0 if not limited
+ */
+int threadLimit()
+{
+    return s_maxThreads.load();
+}
@@ -0,0 +1,13 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QtGlobal>
+#include <functional>
+
+void parallelFor(qsizetype count,qsizetype blockSize,const std::function<void(qsizetype begin,qsizetype end)> &fn);
+
+int maxThreads();
+void setMaxThreads(int threads);
+int threadLimit();
+
+#endif // PARALLEL_H
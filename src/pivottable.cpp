@@ -0,0 +1,347 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "pivottable.h"
+
+#include <cmath>
+
+#include "parallel.h"
+#include "rowgrouping.h"
+
+static const qsizetype maxPivotCells=1<<20; // larger tables can not be read anyway
+static const qsizetype maxPartialCells=1<<22; // cells of all per-thread tables together
+static const qsizetype cellBlockSize=1<<12;
+static const int maxCachedAxes=16;
+static const int maxCachedResults=16;
+
+/*!
+ * \brief unique key of spec for caching
+ * \return
+ */
+QString PivotSpec::key() const
+{
+    return rowKeys.join('\n')+"\t"+columnKeys.join('\n')+"\t"+value+"\t"+QString::number(aggregation.type)+"\t"+QString::number(aggregation.percentile);
+}
+
+PivotEngine::PivotEngine()
+    : m_data(nullptr),m_store(nullptr),m_columns(nullptr),m_generation(0)
+{
+}
+/*!
+ * \brief set data, all cached axes and results are dropped
+ * \param data
+ * \param store
+ * \param columns column names
+ */
+void PivotEngine::setSource(const QVector<QStringList> *data, ColumnStore *store, const QStringList *columns)
+{
+    m_data=data;
+    m_store=store;
+    m_columns=columns;
+    clear();
+    setSelection(RowSelection());
+}
+/*!
+ * \brief set rows which are aggregated, e.g. after filters changed
+ * Cached results become outdated but are kept for incremental update.
+ * \param selection empty for all rows
+ */
+void PivotEngine::setSelection(const RowSelection &selection)
+{
+    const qsizetype rows= (m_data && !m_data->isEmpty()) ? m_data->at(0).size() : 0;
+    if(selection.isEmpty()){
+        m_selection=RowSelection(rows,true);
+    }else{
+        m_selection=selection;
+    }
+    ++m_generation;
+}
+/*!
+ * \brief drop cached axes and results, e.g. after data of a column changed
+ */
+void PivotEngine::clear()
+{
+    m_axes.clear();
+    m_results.clear();
+}
+/*!
+ * \brief pivot table of spec for the current selection
+ * A result of the current selection is returned from cache.
+ * \param spec
+ * \param error reason if no result
+ * \return result or null
+ */
+QSharedPointer<const PivotResult> PivotEngine::compute(const PivotSpec &spec, QString &error)
+{
+    error.clear();
+    if(!m_data || m_data->isEmpty()){
+        error=QObject::tr("no data");
+        return QSharedPointer<const PivotResult>();
+    }
+    const AggregationSpec &aggregation=spec.aggregation;
+    if(aggregation.type==AggregationSpec::AGG_NONE){
+        error=QObject::tr("no aggregation selected");
+        return QSharedPointer<const PivotResult>();
+    }
+    const double *y=nullptr;
+    if(!spec.value.isEmpty()){
+        const int column=m_columns->indexOf(spec.value);
+        if(column<0){
+            error=QObject::tr("unknown column %1").arg(spec.value);
+            return QSharedPointer<const PivotResult>();
+        }
+        y=m_store->numbers(column).data();
+    }else if(aggregation.type!=AggregationSpec::AGG_COUNT){
+        error=QObject::tr("value column missing");
+        return QSharedPointer<const PivotResult>();
+    }
+
+    const QString key=spec.key();
+    QSharedPointer<PivotResult> cached=m_results.value(key);
+    if(cached && cached->generation==m_generation){
+        return cached;
+    }
+    const AggregationSpec::Type type=aggregation.type;
+    const bool reversible= type==AggregationSpec::AGG_COUNT || type==AggregationSpec::AGG_SUM || type==AggregationSpec::AGG_MEAN;
+    if(cached && reversible){
+        // update the full aggregation with rows which left or entered the selection since,
+        // if they are fewer than the selected rows
+        RowSelection removed(cached->baseSelection);
+        removed.andNot(m_selection);
+        RowSelection added(m_selection);
+        added.andNot(cached->baseSelection);
+        if(removed.count()+added.count()<m_selection.count()){
+            QSharedPointer<PivotResult> result(new PivotResult);
+            result->rows=cached->rows;
+            result->columns=cached->columns;
+            result->baseStats=cached->baseStats;
+            result->baseSelection=cached->baseSelection;
+            result->stats=*result->baseStats;
+            std::vector<RunningStats> removedStats,addedStats;
+            accumulate(*result,y,removed,removedStats);
+            accumulate(*result,y,added,addedStats);
+            std::vector<RunningStats> &stats=result->stats;
+            parallelFor(qsizetype(stats.size()),cellBlockSize,[&](qsizetype begin,qsizetype end){
+                for(qsizetype cell=begin;cell<end;++cell){
+                    stats[cell].remove(removedStats[cell]);
+                    stats[cell].merge(addedStats[cell]);
+                }
+            });
+            result->selection=m_selection;
+            result->generation=m_generation;
+            fillValues(spec,y,*result);
+            m_results.insert(key,result);
+            return result;
+        }
+    }
+
+    QSharedPointer<PivotResult> result(new PivotResult);
+    result->rows=axis(spec.rowKeys,error);
+    if(!result->rows) return QSharedPointer<const PivotResult>();
+    result->columns=axis(spec.columnKeys,error);
+    if(!result->columns) return QSharedPointer<const PivotResult>();
+    const qsizetype cells=qsizetype(result->rows->labels.size())*result->columns->labels.size();
+    if(cells>maxPivotCells){
+        error=QObject::tr("too many cells (%1 x %2)").arg(result->rows->labels.size()).arg(result->columns->labels.size());
+        return QSharedPointer<const PivotResult>();
+    }
+    accumulate(*result,y,m_selection,result->stats);
+    result->selection=m_selection;
+    result->generation=m_generation;
+    if(reversible){
+        result->baseStats.reset(new std::vector<RunningStats>(result->stats));
+        result->baseSelection=m_selection;
+    }
+    fillValues(spec,y,*result);
+    if(m_results.size()>=maxCachedResults){
+        m_results.clear();
+    }
+    m_results.insert(key,result);
+    return result;
+}
+/*!
+ * \brief groups of all rows along key columns
+ * Uses the grouping engine, cached per key list.
+ * \param keys
+ * \param error
+ * \return axis or null
+ */
+QSharedPointer<const PivotAxis> PivotEngine::axis(const QStringList &keys, QString &error)
+{
+    const QString key=keys.join('\n');
+    QSharedPointer<const PivotAxis> cached=m_axes.value(key);
+    if(cached) return cached;
+    QList<int> columns;
+    for(const QString &name:keys){
+        const int column=m_columns->indexOf(name);
+        if(column<0){
+            error=QObject::tr("unknown column %1").arg(name);
+            return QSharedPointer<const PivotAxis>();
+        }
+        columns<<column;
+    }
+    const qsizetype rows=m_data->at(0).size();
+    RowGrouping grouping;
+    grouping.compute(*m_data,*m_store,columns,RowSelection(rows,true));
+    QSharedPointer<PivotAxis> axis(new PivotAxis);
+    for(int group=0;group<grouping.groupCount();++group){
+        axis->labels<<(keys.isEmpty() ? QObject::tr("all") : grouping.values(group).join(" / "));
+    }
+    axis->groupOf.resize(rows);
+    int *groupOf=axis->groupOf.data();
+    parallelFor(grouping.groupCount(),1,[&grouping,groupOf](qsizetype begin,qsizetype end){
+        for(qsizetype group=begin;group<end;++group){
+            for(int row:grouping.rows(int(group))){
+                groupOf[row]=int(group);
+            }
+        }
+    });
+    if(m_axes.size()>=maxCachedAxes){
+        m_axes.clear();
+    }
+    m_axes.insert(key,axis);
+    return axis;
+}
+/*!
+ * \brief accumulate values of selected rows per cell
+ * Blocks of rows are accumulated in parallel into own tables which are merged afterwards,
+ * as long as the tables are small. Large tables are filled by one thread.
+ * \param result provides the axes
+ * \param y values, nullptr to count rows
+ * \param selection
+ * \param stats statistics per cell
+ */
+void PivotEngine::accumulate(const PivotResult &result, const double *y, const RowSelection &selection, std::vector<RunningStats> &stats) const
+{
+    const qsizetype columnGroups=result.columns->labels.size();
+    const qsizetype cells=qsizetype(result.rows->labels.size())*columnGroups;
+    const int *rowOf=result.rows->groupOf.data();
+    const int *columnOf=result.columns->groupOf.data();
+    const qsizetype size=selection.size();
+    const qsizetype parts=qBound<qsizetype>(1,maxPartialCells/qMax<qsizetype>(1,cells),maxThreads());
+    const qsizetype partSize=((size+parts-1)/parts+63)/64*64;
+    std::vector<std::vector<RunningStats>> partial(parts);
+    parallelFor(parts,1,[&](qsizetype part,qsizetype){
+        std::vector<RunningStats> &local=partial[part];
+        local.resize(cells);
+        const qsizetype begin=part*partSize;
+        selection.forEach(begin,qMin(size,begin+partSize),[&](qsizetype row){
+            local[qsizetype(rowOf[row])*columnGroups+columnOf[row]].add(y ? y[row] : 0.);
+        });
+    });
+    stats=std::move(partial[0]);
+    if(parts>1){
+        parallelFor(cells,cellBlockSize,[&](qsizetype begin,qsizetype end){
+            for(qsizetype cell=begin;cell<end;++cell){
+                for(qsizetype part=1;part<parts;++part){
+                    stats[cell].merge(partial[part][cell]);
+                }
+            }
+        });
+    }
+}
+/*!
+ * \brief compute shown value per cell from statistics
+ * Median/percentiles collect the values of all cells in one array (counting sort by cell)
+ * and select per cell in parallel.
+ * \param spec
+ * \param y
+ * \param result
+ */
+void PivotEngine::fillValues(const PivotSpec &spec, const double *y, PivotResult &result) const
+{
+    const AggregationSpec &aggregation=spec.aggregation;
+    const std::vector<RunningStats> &stats=result.stats;
+    const qsizetype cells=qsizetype(stats.size());
+    result.values.assign(cells,std::nan(""));
+    if(!aggregation.needsValues()){
+        parallelFor(cells,cellBlockSize,[&](qsizetype begin,qsizetype end){
+            for(qsizetype cell=begin;cell<end;++cell){
+                if(stats[cell].count>0){
+                    result.values[cell]=aggregation.valueOf(stats[cell]);
+                }
+            }
+        });
+        return;
+    }
+    const qsizetype columnGroups=result.columns->labels.size();
+    const int *rowOf=result.rows->groupOf.data();
+    const int *columnOf=result.columns->groupOf.data();
+    std::vector<qsizetype> offsets(cells+1,0);
+    for(qsizetype cell=0;cell<cells;++cell){
+        offsets[cell+1]=offsets[cell]+stats[cell].count;
+    }
+    std::vector<double> values(offsets[cells]);
+    std::vector<qsizetype> fill(offsets.begin(),offsets.end()-1);
+    result.selection.forEach([&](qsizetype row){
+        const double value= y ? y[row] : 0.;
+        if(std::isnan(value)) return;
+        values[fill[qsizetype(rowOf[row])*columnGroups+columnOf[row]]++]=value;
+    });
+    const double percentile= aggregation.type==AggregationSpec::AGG_MEDIAN ? 50 : aggregation.percentile;
+    parallelFor(cells,cellBlockSize,[&](qsizetype begin,qsizetype end){
+        std::vector<double> cellValues;
+        for(qsizetype cell=begin;cell<end;++cell){
+            if(offsets[cell]==offsets[cell+1]) continue;
+            cellValues.assign(values.begin()+offsets[cell],values.begin()+offsets[cell+1]);
+            result.values[cell]=percentileOf(cellValues,percentile);
+        }
+    });
+}
+
+PivotModel::PivotModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+/*!
+ * \brief show result
+ * \param result may be null to show nothing
+ */
+void PivotModel::setResult(QSharedPointer<const PivotResult> result)
+{
+    beginResetModel();
+    m_result=result;
+    endResetModel();
+}
+
+int PivotModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid() || !m_result) return 0;
+    return m_result->rows->labels.size();
+}
+
+int PivotModel::columnCount(const QModelIndex &parent) const
+{
+    if(parent.isValid() || !m_result) return 0;
+    return m_result->columns->labels.size();
+}
+
+QVariant PivotModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || !m_result) return QVariant();
+    const qsizetype cell=qsizetype(index.row())*m_result->columns->labels.size()+index.column();
+    if(role==Qt::DisplayRole){
+        const double value=m_result->values[cell];
+        if(std::isnan(value)) return QVariant();
+        return QString::number(value);
+    }
+    if(role==Qt::ToolTipRole){
+        return tr("%1 values").arg(m_result->stats[cell].count);
+    }
+    if(role==Qt::TextAlignmentRole){
+        return int(Qt::AlignRight|Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QVariant PivotModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(!m_result || role!=Qt::DisplayRole) return QVariant();
+    const QStringList &labels= orientation==Qt::Vertical ? m_result->rows->labels : m_result->columns->labels;
+    return labels.value(section);
+}
@@ -0,0 +1,106 @@
+#ifndef PIVOTTABLE_H
+#define PIVOTTABLE_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+
+#include "aggregation.h"
+#include "columnstore.h"
+#include "rowselection.h"
+
+/*!
+ * \brief what a pivot table shows
+ * Groups of the row keys form the rows, groups of the column keys the columns,
+ * each cell aggregates the value column over the rows of both groups.
+ */
+struct PivotSpec{
+    QStringList rowKeys;
+    QStringList columnKeys;
+    QString value; // may be empty for count
+    AggregationSpec aggregation;
+
+    QString key() const;
+};
+
+/*!
+ * \brief groups of all rows of the data along one pivot axis
+ * Independent of filters, so it is kept when filters change.
+ */
+struct PivotAxis{
+    QStringList labels; // per group
+    std::vector<int> groupOf; // per data row
+};
+
+/*!
+ * \brief aggregated cells of a pivot table, row major
+ */
+struct PivotResult{
+    QSharedPointer<const PivotAxis> rows;
+    QSharedPointer<const PivotAxis> columns;
+    std::vector<double> values;
+    std::vector<RunningStats> stats; // per cell
+    RowSelection selection; // rows the result was computed for
+    int generation=-1; // of selection
+    QSharedPointer<const std::vector<RunningStats>> baseStats; // of the last full aggregation
+    RowSelection baseSelection; // rows of baseStats
+};
+
+/*!
+ * \brief computes pivot tables with the grouping engine
+ * Axes are cached per key list, results per pivot spec.
+ * A change of the selection (filters) keeps the axes. Statistics which can be
+ * taken back (count, sum, mean) are updated with the rows which differ from the
+ * last full aggregation, so rounding errors do not add up over many updates.
+ * The others, and std which is sensitive to cancellation, aggregate the selected rows again.
+ */
+class PivotEngine
+{
+public:
+    PivotEngine();
+
+    void setSource(const QVector<QStringList> *data,ColumnStore *store,const QStringList *columns);
+    void setSelection(const RowSelection &selection);
+    void clear();
+
+    QSharedPointer<const PivotResult> compute(const PivotSpec &spec,QString &error);
+
+private:
+    QSharedPointer<const PivotAxis> axis(const QStringList &keys,QString &error);
+    void accumulate(const PivotResult &result,const double *y,const RowSelection &selection,std::vector<RunningStats> &stats) const;
+    void fillValues(const PivotSpec &spec,const double *y,PivotResult &result) const;
+
+    const QVector<QStringList> *m_data;
+    ColumnStore *m_store;
+    const QStringList *m_columns;
+    RowSelection m_selection; // rows passing the filters
+    int m_generation;
+    QHash<QString,QSharedPointer<const PivotAxis>> m_axes;
+    QHash<QString,QSharedPointer<PivotResult>> m_results;
+};
+
+/*!
+ * \brief table model which serves a pivot result
+ * Cells are formatted on request.
+ */
+class PivotModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    PivotModel(QObject *parent = nullptr);
+
+    void setResult(QSharedPointer<const PivotResult> result);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    QSharedPointer<const PivotResult> m_result;
+};
+
+#endif // PIVOTTABLE_H
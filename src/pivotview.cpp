@@ -0,0 +1,181 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "pivotview.h"
+
+#include <QLineEdit>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QTableView>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QElapsedTimer>
+
+/*!
+ * \brief split comma separated column names
+ * \param text
+ * \return
+ */
+static QStringList columnNames(const QString &text)
+{
+    QStringList result;
+    for(const QString &name:text.split(',',Qt::SkipEmptyParts)){
+        const QString trimmed=name.trimmed();
+        if(!trimmed.isEmpty()){
+            result<<trimmed;
+        }
+    }
+    return result;
+}
+
+PivotView::PivotView(QWidget *parent)
+    : QWidget(parent),m_outdated(false)
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    QFormLayout *formLayout = new QFormLayout;
+    leRows = new QLineEdit;
+    leRows->setPlaceholderText(tr("column names separated by comma, e.g. corner"));
+    formLayout->addRow(tr("Rows:"),leRows);
+    leColumns = new QLineEdit;
+    leColumns->setPlaceholderText(tr("column names separated by comma, e.g. temp"));
+    formLayout->addRow(tr("Columns:"),leColumns);
+    QHBoxLayout *hLayout = new QHBoxLayout;
+    leValue = new QLineEdit;
+    leValue->setPlaceholderText(tr("column name, e.g. gain"));
+    hLayout->addWidget(leValue,1);
+    cbAggregation = new QComboBox;
+    const QStringList aggregationNames={tr("mean"),tr("median"),tr("min"),tr("max"),tr("std"),tr("count"),tr("sum"),tr("percentile")};
+    for(int type=AggregationSpec::AGG_MEAN;type<=AggregationSpec::AGG_PERCENTILE;++type){
+        cbAggregation->addItem(aggregationNames.at(type-AggregationSpec::AGG_MEAN),type);
+    }
+    hLayout->addWidget(cbAggregation);
+    sbPercentile = new QDoubleSpinBox;
+    sbPercentile->setRange(0,100);
+    sbPercentile->setValue(50);
+    sbPercentile->setSuffix("%");
+    sbPercentile->setEnabled(false);
+    hLayout->addWidget(sbPercentile);
+    formLayout->addRow(tr("Value:"),hLayout);
+    mainLayout->addLayout(formLayout);
+    lblStatus = new QLabel;
+    mainLayout->addWidget(lblStatus);
+    tableView = new QTableView;
+    m_model = new PivotModel(this);
+    tableView->setModel(m_model);
+    mainLayout->addWidget(tableView,3);
+    setLayout(mainLayout);
+
+    connect(leRows,&QLineEdit::editingFinished,this,&PivotView::refresh);
+    connect(leColumns,&QLineEdit::editingFinished,this,&PivotView::refresh);
+    connect(leValue,&QLineEdit::editingFinished,this,&PivotView::refresh);
+    connect(cbAggregation,QOverload<int>::of(&QComboBox::currentIndexChanged),this,[this](){
+        sbPercentile->setEnabled(cbAggregation->currentData().toInt()==AggregationSpec::AGG_PERCENTILE);
+        refresh();
+    });
+    connect(sbPercentile,&QDoubleSpinBox::editingFinished,this,&PivotView::refresh);
+}
+/*!
+ * \brief set data, cached tables are dropped
+ * \param data
+ * \param store
+ * \param columns column names
+ */
+void PivotView::setSource(const QVector<QStringList> *data, ColumnStore *store, const QStringList *columns)
+{
+    m_engine.setSource(data,store,columns);
+    m_model->setResult(QSharedPointer<const PivotResult>());
+    lblStatus->clear();
+    m_outdated=true;
+}
+/*!
+ * \brief rows passing the filters
+ * Updated immediately when visible, otherwise when shown.
+ * \param selection empty for all rows
+ */
+void PivotView::setSelection(const RowSelection &selection)
+{
+    m_engine.setSelection(selection);
+    if(isVisible()){
+        refresh();
+    }else{
+        m_outdated=true;
+    }
+}
+/*!
+ * \brief data of a column changed, cached tables are dropped
+ */
+void PivotView::invalidate()
+{
+    m_engine.clear();
+    m_outdated=true;
+}
+/*!
+ * \brief show spec in editors and compute table
+ * \param spec
+ */
+void PivotView::setSpec(const PivotSpec &spec)
+{
+    leRows->setText(spec.rowKeys.join(", "));
+    leColumns->setText(spec.columnKeys.join(", "));
+    leValue->setText(spec.value);
+    sbPercentile->setValue(spec.aggregation.percentile);
+    const int index=cbAggregation->findData(spec.aggregation.type);
+    const QSignalBlocker blocker(cbAggregation);
+    cbAggregation->setCurrentIndex(qMax(0,index));
+    sbPercentile->setEnabled(cbAggregation->currentData().toInt()==AggregationSpec::AGG_PERCENTILE);
+    refresh();
+}
+/*!
+ * \brief spec from editors
+ * \return
+ */
+PivotSpec PivotView::spec() const
+{
+    PivotSpec spec;
+    spec.rowKeys=columnNames(leRows->text());
+    spec.columnKeys=columnNames(leColumns->text());
+    spec.value=leValue->text().trimmed();
+    spec.aggregation.type=static_cast<AggregationSpec::Type>(cbAggregation->currentData().toInt());
+    spec.aggregation.percentile=sbPercentile->value();
+    return spec;
+}
+/*!
+ * \brief compute table of current spec
+ * Results are taken from cache if spec and filters did not change.
+ */
+void PivotView::refresh()
+{
+    m_outdated=false;
+    const PivotSpec pivot=spec();
+    if(pivot.rowKeys.isEmpty() && pivot.columnKeys.isEmpty() && pivot.value.isEmpty()){
+        m_model->setResult(QSharedPointer<const PivotResult>());
+        lblStatus->clear();
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    QSharedPointer<const PivotResult> result=m_engine.compute(pivot,error);
+    m_model->setResult(result);
+    if(!result){
+        lblStatus->setText(error);
+        return;
+    }
+    lblStatus->setText(tr("%1 x %2 cells, %3 rows, %4 ms").arg(result->rows->labels.size()).arg(result->columns->labels.size())
+                       .arg(result->selection.count()).arg(timer.elapsed()));
+}
+
+void PivotView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if(m_outdated){
+        refresh();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef PIVOTVIEW_H
+#define PIVOTVIEW_H
+
+#include <QWidget>
+#include <QVector>
+#include <QStringList>
+
+#include "pivottable.h"
+
+class QLineEdit;
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+class QTableView;
+
+/*!
+ * \brief pivot table tab
+ * Row keys, column keys and value are given as column names.
+ * The table is computed when the spec is edited and, while visible, when filters change.
+ */
+class PivotView : public QWidget
+{
+    Q_OBJECT
+public:
+    PivotView(QWidget *parent = nullptr);
+
+    void setSource(const QVector<QStringList> *data,ColumnStore *store,const QStringList *columns);
+    void setSelection(const RowSelection &selection);
+    void invalidate();
+
+    void setSpec(const PivotSpec &spec);
+    PivotSpec spec() const;
+    void refresh();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private:
+    QLineEdit *leRows;
+    QLineEdit *leColumns;
+    QLineEdit *leValue;
+    QComboBox *cbAggregation;
+    QDoubleSpinBox *sbPercentile;
+    QLabel *lblStatus;
+    QTableView *tableView;
+
+    PivotModel *m_model;
+    PivotEngine m_engine;
+    bool m_outdated; // selection changed while hidden
+};
+
+#endif // PIVOTVIEW_H
@@ -0,0 +1,420 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "queryexpression.h"
+
+#include <QRegularExpression>
+#include <algorithm>
+#include <vector>
+
+#include "filterkernels.h"
+#include "parallel.h"
+
+static const qsizetype queryBlockSize=1<<15; // rows evaluated at once by one thread, multiple of 64
+
+QueryExpression::QueryExpression():m_current(0),m_columnIndex(nullptr),m_store(nullptr)
+{
+}
+/*!
+ * \brief compile expression against current columns
+ * Column names are resolved and constants converted according to column type.
+ * \param text
+ * \param columnIndex column name -> column
+ * \param store
+ * \return false on syntax error or unknown column, see errorString()
+ */
+bool QueryExpression::compile(const QString &text, const QHash<QString, int> &columnIndex, ColumnStore &store)
+{
+    m_text=text;
+    m_error.clear();
+    m_root.reset();
+    if(text.trimmed().isEmpty()) return true;
+    if(!tokenize(text)) return false;
+    m_columnIndex=&columnIndex;
+    m_store=&store;
+    m_current=0;
+    std::unique_ptr<QueryNode> root=parseOr();
+    if(root && m_tokens[m_current].kind!=Token::TOK_END){
+        fail(tr("unexpected '%1'").arg(m_tokens[m_current].text),m_tokens[m_current].pos);
+        root.reset();
+    }
+    m_tokens.clear();
+    m_columnIndex=nullptr;
+    m_store=nullptr;
+    if(!root) return false;
+    m_root=std::move(root);
+    return true;
+}
+/*!
+ * \brief no condition, all rows pass
+ * \return
+ */
+bool QueryExpression::isEmpty() const
+{
+    return m_root==nullptr;
+}
+
+QString QueryExpression::text() const
+{
+    return m_text;
+}
+/*!
+ * \brief description of last compile error
+ * \return
+ */
+QString QueryExpression::errorString() const
+{
+    return m_error;
+}
+/*!
+ * \brief columns used in expression
+ * \return
+ */
+QList<int> QueryExpression::columns() const
+{
+    QList<int> result;
+    if(m_root){
+        collectColumns(m_root.get(),result);
+    }
+    return result;
+}
+/*!
+ * \brief remove rows from visible which don't fulfill the expression
+ * Columns are prepared (numbers, dictionaries) once, then the expression
+ * is evaluated block-wise in parallel. Each block writes its own words of visible.
+ * \param data
+ * \param store
+ * \param visible
+ */
+void QueryExpression::evaluate(const QVector<QStringList> &data, ColumnStore &store, RowSelection &visible)
+{
+    if(!m_root) return;
+    prepareNode(m_root.get(),data,store);
+    quint64 *words=visible.words();
+    parallelFor(visible.size(),queryBlockSize,[this,words](qsizetype begin,qsizetype end){
+        std::vector<quint64> pass(RowSelection::wordsFor(end-begin));
+        evaluateNode(m_root.get(),begin,end,pass.data());
+        andKernel(words+begin/64,pass.data(),RowSelection::wordsFor(end-begin));
+    });
+}
+/*!
+ * \brief split text into tokens
+ * \param text
+ * \return false on unterminated string
+ */
+bool QueryExpression::tokenize(const QString &text)
+{
+    static const QString special("()&|<>=!\"'");
+    m_tokens.clear();
+    int i=0;
+    const int n=text.length();
+    while(i<n){
+        const QChar c=text.at(i);
+        if(c.isSpace()){
+            ++i;
+            continue;
+        }
+        Token token;
+        token.pos=i;
+        if(c=='('){
+            token.kind=Token::TOK_LPAREN;
+            token.text=c;
+            ++i;
+        }else if(c==')'){
+            token.kind=Token::TOK_RPAREN;
+            token.text=c;
+            ++i;
+        }else if(c=='&' || c=='|'){
+            token.kind= c=='&' ? Token::TOK_AND : Token::TOK_OR;
+            token.text=c;
+            ++i;
+            if(i<n && text.at(i)==c) ++i; // && and || are accepted as well
+        }else if(c=='>' || c=='<' || c=='='){
+            token.kind=Token::TOK_OP;
+            token.text=c;
+            ++i;
+            if(i<n && text.at(i)=='='){
+                token.text+='=';
+                ++i;
+            }
+        }else if(c=='!'){
+            ++i;
+            if(i<n && text.at(i)=='='){
+                token.kind=Token::TOK_OP;
+                token.text="!=";
+                ++i;
+            }else if(text.mid(i,8)=="contains" || text.mid(i,5)=="regex"){
+                const int length= text.at(i)=='c' ? 8 : 5;
+                token.kind=Token::TOK_OP;
+                token.text="!"+text.mid(i,length);
+                i+=length;
+            }else{
+                token.kind=Token::TOK_NOT;
+                token.text=c;
+            }
+        }else if(c=='"' || c=='\''){
+            token.kind=Token::TOK_STRING;
+            ++i;
+            bool closed=false;
+            while(i<n){
+                const QChar d=text.at(i);
+                if(d=='\\' && i+1<n){
+                    token.text+=text.at(i+1);
+                    i+=2;
+                    continue;
+                }
+                ++i;
+                if(d==c){
+                    closed=true;
+                    break;
+                }
+                token.text+=d;
+            }
+            if(!closed){
+                return fail(tr("unterminated string"),token.pos);
+            }
+        }else{
+            token.kind=Token::TOK_WORD;
+            while(i<n && !text.at(i).isSpace() && !special.contains(text.at(i))){
+                token.text+=text.at(i);
+                ++i;
+            }
+            if(token.text=="contains" || token.text=="regex"){
+                token.kind=Token::TOK_OP;
+            }
+        }
+        m_tokens.append(token);
+    }
+    Token end;
+    end.pos=n;
+    m_tokens.append(end);
+    return true;
+}
+/*!
+ * \brief or-expression: and-expression { | and-expression }
+ * \return nullptr on error
+ */
+std::unique_ptr<QueryNode> QueryExpression::parseOr()
+{
+    std::unique_ptr<QueryNode> node=parseAnd();
+    while(node && m_tokens[m_current].kind==Token::TOK_OR){
+        ++m_current;
+        std::unique_ptr<QueryNode> right=parseAnd();
+        if(!right) return nullptr;
+        std::unique_ptr<QueryNode> parent(new QueryNode);
+        parent->type=QueryNode::QUERY_OR;
+        parent->left=std::move(node);
+        parent->right=std::move(right);
+        node=std::move(parent);
+    }
+    return node;
+}
+/*!
+ * \brief and-expression: unary { & unary }
+ * \return nullptr on error
+ */
+std::unique_ptr<QueryNode> QueryExpression::parseAnd()
+{
+    std::unique_ptr<QueryNode> node=parseUnary();
+    while(node && m_tokens[m_current].kind==Token::TOK_AND){
+        ++m_current;
+        std::unique_ptr<QueryNode> right=parseUnary();
+        if(!right) return nullptr;
+        std::unique_ptr<QueryNode> parent(new QueryNode);
+        parent->type=QueryNode::QUERY_AND;
+        parent->left=std::move(node);
+        parent->right=std::move(right);
+        node=std::move(parent);
+    }
+    return node;
+}
+/*!
+ * \brief unary: ! unary | ( or-expression ) | term
+ * \return nullptr on error
+ */
+std::unique_ptr<QueryNode> QueryExpression::parseUnary()
+{
+    const Token &token=m_tokens[m_current];
+    if(token.kind==Token::TOK_NOT){
+        ++m_current;
+        std::unique_ptr<QueryNode> operand=parseUnary();
+        if(!operand) return nullptr;
+        std::unique_ptr<QueryNode> node(new QueryNode);
+        node->type=QueryNode::QUERY_NOT;
+        node->left=std::move(operand);
+        return node;
+    }
+    if(token.kind==Token::TOK_LPAREN){
+        ++m_current;
+        std::unique_ptr<QueryNode> node=parseOr();
+        if(!node) return nullptr;
+        if(m_tokens[m_current].kind!=Token::TOK_RPAREN){
+            fail(tr("missing ')'"),m_tokens[m_current].pos);
+            return nullptr;
+        }
+        ++m_current;
+        return node;
+    }
+    return parseTerm();
+}
+/*!
+ * \brief term: column operator value
+ * \return nullptr on error
+ */
+std::unique_ptr<QueryNode> QueryExpression::parseTerm()
+{
+    const Token &name=m_tokens[m_current];
+    if(name.kind!=Token::TOK_WORD && name.kind!=Token::TOK_STRING){
+        fail(name.kind==Token::TOK_END ? tr("unexpected end of query") : tr("column name expected"),name.pos);
+        return nullptr;
+    }
+    const int column=m_columnIndex->value(name.text,-1);
+    if(column<0){
+        fail(tr("unknown column '%1'").arg(name.text),name.pos);
+        return nullptr;
+    }
+    const Token &op=m_tokens[m_current+1];
+    if(op.kind!=Token::TOK_OP){
+        fail(tr("operator expected after '%1'").arg(name.text),op.pos);
+        return nullptr;
+    }
+    const Token &value=m_tokens[m_current+2];
+    if(value.kind!=Token::TOK_WORD && value.kind!=Token::TOK_STRING){
+        fail(tr("value expected after '%1'").arg(op.text),value.pos);
+        return nullptr;
+    }
+    int operatorType=-1000;
+    if(op.text==">") operatorType=2;
+    else if(op.text==">=") operatorType=1;
+    else if(op.text=="=" || op.text=="==") operatorType=0;
+    else if(op.text=="<=") operatorType=-1;
+    else if(op.text=="<") operatorType=-2;
+    else if(op.text=="!=") operatorType=-3;
+    else if(op.text=="contains") operatorType=10;
+    else if(op.text=="!contains") operatorType=11;
+    else if(op.text=="regex") operatorType=12;
+    else if(op.text=="!regex") operatorType=13;
+    if(operatorType<-10){
+        fail(tr("unknown operator '%1'").arg(op.text),op.pos);
+        return nullptr;
+    }
+    if(operatorType>=12 && !QRegularExpression(value.text).isValid()){
+        fail(tr("invalid regular expression '%1'").arg(value.text),value.pos);
+        return nullptr;
+    }
+    ColumnType type=m_store->type(column);
+    if(type==COL_INT || type==COL_FLOAT){
+        // quoted text which is no number is compared as string
+        bool ok=true;
+        if(type==COL_INT){
+            ColumnStore::toLong(value.text.trimmed(),ok);
+        }
+        if(type==COL_FLOAT || !ok){
+            value.text.trimmed().toDouble(&ok);
+        }
+        if(!ok && value.kind==Token::TOK_STRING){
+            type=COL_STRING;
+        }else if(!ok && operatorType<10){
+            fail(tr("number expected for '%1', quote text to compare as string").arg(name.text),value.pos);
+            return nullptr;
+        }
+    }
+    std::unique_ptr<QueryNode> node(new QueryNode);
+    node->type=QueryNode::QUERY_TERM;
+    node->column=column;
+    node->term.compileTerm(operatorType,value.text,type);
+    m_current+=3;
+    return node;
+}
+/*!
+ * \brief record error
+ * \param message
+ * \param pos position in query text
+ * \return false
+ */
+bool QueryExpression::fail(const QString &message, int pos)
+{
+    if(m_error.isEmpty()){
+        m_error=tr("%1 (at position %2)").arg(message).arg(pos+1);
+    }
+    return false;
+}
+
+void QueryExpression::prepareNode(QueryNode *node, const QVector<QStringList> &data, ColumnStore &store)
+{
+    if(node->type!=QueryNode::QUERY_TERM){
+        prepareNode(node->left.get(),data,store);
+        if(node->right){
+            prepareNode(node->right.get(),data,store);
+        }
+        return;
+    }
+    FilterInput input;
+    input.cells=&data.at(node->column);
+    if(node->term.isNumeric()){
+        input.numbers=store.numbers(node->column).data();
+    }
+    if(node->term.hasTextTerms()){
+        input.dictionary=store.dictionary(node->column);
+    }
+    node->input=input;
+    node->term.prepare(input);
+}
+
+void QueryExpression::evaluateNode(const QueryNode *node, qsizetype begin, qsizetype end, quint64 *words) const
+{
+    const qsizetype wordCount=RowSelection::wordsFor(end-begin);
+    switch(node->type){
+    case QueryNode::QUERY_TERM:
+        node->term.evaluate(node->input,begin,end,words);
+        break;
+    case QueryNode::QUERY_NOT:
+    {
+        evaluateNode(node->left.get(),begin,end,words);
+        for(qsizetype i=0;i<wordCount;++i){
+            words[i]=~words[i];
+        }
+        const int rest=(end-begin)&63;
+        if(rest!=0){
+            words[wordCount-1]&=(quint64(1)<<rest)-1;
+        }
+        break;
+    }
+    case QueryNode::QUERY_AND:
+    case QueryNode::QUERY_OR:
+    {
+        evaluateNode(node->left.get(),begin,end,words);
+        if(node->type==QueryNode::QUERY_AND){
+            // right side is not needed if no row of block is left
+            if(std::all_of(words,words+wordCount,[](quint64 w){return w==0;})) break;
+        }
+        std::vector<quint64> right(wordCount);
+        evaluateNode(node->right.get(),begin,end,right.data());
+        if(node->type==QueryNode::QUERY_AND){
+            andKernel(words,right.data(),wordCount);
+        }else{
+            orKernel(words,right.data(),wordCount);
+        }
+        break;
+    }
+    }
+}
+
+void QueryExpression::collectColumns(const QueryNode *node, QList<int> &columns) const
+{
+    if(node->type==QueryNode::QUERY_TERM){
+        if(!columns.contains(node->column)){
+            columns.append(node->column);
+        }
+        return;
+    }
+    collectColumns(node->left.get(),columns);
+    if(node->right){
+        collectColumns(node->right.get(),columns);
+    }
+}
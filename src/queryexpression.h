@@ -0,0 +1,79 @@
+#ifndef QUERYEXPRESSION_H
+#define QUERYEXPRESSION_H
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <memory>
+
+#include "columnstore.h"
+#include "filterquery.h"
+#include "rowselection.h"
+
+/*!
+ * \brief node of compiled query expression
+ * Terms compare one column, inner nodes combine them with and/or/not.
+ */
+struct QueryNode{
+    enum Type {QUERY_AND,QUERY_OR,QUERY_NOT,QUERY_TERM};
+
+    Type type=QUERY_TERM;
+    int column=-1;
+    FilterQuery term;
+    FilterInput input; // set before evaluation
+    std::unique_ptr<QueryNode> left,right; // not uses left only
+};
+
+/*!
+ * \brief boolean expression over several columns
+ * e.g. (temp > 85 | vdd < 0.9) & corner != "ff" & freq >= 1e9
+ * Terms: column operator value with operators >,>=,<,<=,=,==,!=,contains,!contains,regex,!regex.
+ * Column names and values can be quoted with " or ', terms are combined with &, |, ! and parentheses.
+ * & binds stronger than |.
+ */
+class QueryExpression
+{
+    Q_DECLARE_TR_FUNCTIONS(QueryExpression)
+public:
+    QueryExpression();
+
+    bool compile(const QString &text,const QHash<QString,int> &columnIndex,ColumnStore &store);
+    bool isEmpty() const;
+    QString text() const;
+    QString errorString() const;
+    QList<int> columns() const;
+
+    void evaluate(const QVector<QStringList> &data,ColumnStore &store,RowSelection &visible);
+
+private:
+    struct Token{
+        enum Kind {TOK_LPAREN,TOK_RPAREN,TOK_AND,TOK_OR,TOK_NOT,TOK_OP,TOK_WORD,TOK_STRING,TOK_END};
+        Kind kind=TOK_END;
+        QString text;
+        int pos=0;
+    };
+    bool tokenize(const QString &text);
+    std::unique_ptr<QueryNode> parseOr();
+    std::unique_ptr<QueryNode> parseAnd();
+    std::unique_ptr<QueryNode> parseUnary();
+    std::unique_ptr<QueryNode> parseTerm();
+    bool fail(const QString &message,int pos);
+
+    void prepareNode(QueryNode *node,const QVector<QStringList> &data,ColumnStore &store);
+    void evaluateNode(const QueryNode *node,qsizetype begin,qsizetype end,quint64 *words) const;
+    void collectColumns(const QueryNode *node,QList<int> &columns) const;
+
+    QString m_text;
+    QString m_error;
+    std::unique_ptr<QueryNode> m_root;
+    // parser state
+    QVector<Token> m_tokens;
+    int m_current;
+    const QHash<QString,int> *m_columnIndex;
+    ColumnStore *m_store;
+};
+
+#endif // QUERYEXPRESSION_H
@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "radixsort.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const std::size_t minRadixSize=256; // smaller inputs are sorted by comparison
+static const int digitBits=11; // 6 passes, counts of one digit fit into L1 cache
+static const int digits=1<<digitBits;
+static const int passes=(64+digitBits-1)/digitBits;
+
+/*!
+ * \brief IEEE-754 bit pattern of value as unsigned integer with the same order
+ * Negative numbers have all bits inverted, positive ones only the sign bit.
+ * \param value not NaN
+ * \return
+ */
+quint64 orderedBits(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits,&value,sizeof(bits));
+    const quint64 mask= (bits>>63) ? ~quint64(0) : quint64(1)<<63;
+    return bits^mask;
+}
+/*!
+ * \brief stable sort of row ids by their value
+ * LSD radix sort over 11 bit digits of the ordered bit patterns. Keys and row ids are moved together,
+ * values are read once. Digits which are equal for all keys (e.g. sign and exponent) are skipped.
+ * Input which is already sorted (e.g. rows in sweep order) is detected and left as is.
+ * \param rows row ids, values must not be NaN
+ * \param values value per row
+ */
+void sortRowsByValue(std::vector<int> &rows, const double *values)
+{
+    const std::size_t n=rows.size();
+    std::vector<quint64> keys(n);
+    bool sorted=true;
+    for(std::size_t i=0;i<n;++i){
+        keys[i]=orderedBits(values[rows[i]]);
+        if(i>0 && keys[i]<keys[i-1]){
+            sorted=false;
+        }
+    }
+    if(sorted) return;
+    if(n<minRadixSize){
+        std::vector<std::size_t> order(n);
+        for(std::size_t i=0;i<n;++i){
+            order[i]=i;
+        }
+        std::stable_sort(order.begin(),order.end(),[&keys](std::size_t a,std::size_t b){
+            return keys[a]<keys[b];
+        });
+        std::vector<int> result(n);
+        for(std::size_t i=0;i<n;++i){
+            result[i]=rows[order[i]];
+        }
+        rows.swap(result);
+        return;
+    }
+    // histograms of all digits in one pass
+    std::vector<std::size_t> counts(passes*digits,0);
+    for(quint64 key:keys){
+        for(int pass=0;pass<passes;++pass){
+            ++counts[pass*digits+((key>>(digitBits*pass))&(digits-1))];
+        }
+    }
+    std::vector<quint64> keysOut(n);
+    std::vector<int> rowsOut(n);
+    for(int pass=0;pass<passes;++pass){
+        const int shift=digitBits*pass;
+        std::size_t *count=counts.data()+pass*digits;
+        if(count[(keys[0]>>shift)&(digits-1)]==n) continue; // all keys share this digit
+        std::size_t offset=0;
+        for(int digit=0;digit<digits;++digit){
+            const std::size_t c=count[digit];
+            count[digit]=offset;
+            offset+=c;
+        }
+        for(std::size_t i=0;i<n;++i){
+            const std::size_t pos=count[(keys[i]>>shift)&(digits-1)]++;
+            keysOut[pos]=keys[i];
+            rowsOut[pos]=rows[i];
+        }
+        keys.swap(keysOut);
+        rows.swap(rowsOut);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <QtGlobal>
+#include <vector>
+
+quint64 orderedBits(double value);
+void sortRowsByValue(std::vector<int> &rows,const double *values);
+
+#endif // RADIXSORT_H
@@ -0,0 +1,302 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "rowgrouping.h"
+
+#include <QHash>
+#include <algorithm>
+
+#include "parallel.h"
+
+static const qsizetype denseKeyLimit=1<<16; // largest direct lookup table for (prefix,code) per level and block
+static const qsizetype minGroupBlockSize=1<<16;
+
+/*!
+ * \brief read-only description of one key column
+ */
+struct GroupSource{
+    const QStringList *cells=nullptr;
+    const quint32 *codes=nullptr; // dictionary codes, if available
+    qsizetype width=0; // number of codes
+    qsizetype denseSize=0; // size of direct lookup table, 0 if hashed
+};
+
+/*!
+ * \brief grouping of one block of rows, built by one thread
+ * Ids are local to the block and handed out in order of first occurrence.
+ */
+struct PartialGrouping{
+    struct Level{
+        QHash<QString,quint32> valueCodes; // local codes of columns without dictionary
+        QStringList values;
+        std::vector<int> dense;
+        QHash<quint64,int> ids;
+        std::vector<int> parent;
+        std::vector<quint32> code;
+    };
+    std::vector<Level> levels;
+    std::vector<std::vector<int>> rows; // per id of last level
+
+    void build(const std::vector<GroupSource> &sources,const RowSelection &selection,qsizetype begin,qsizetype end);
+};
+/*!
+ * \brief group rows of selection in [begin,end)
+ * \param sources
+ * \param selection
+ * \param begin
+ * \param end
+ */
+void PartialGrouping::build(const std::vector<GroupSource> &sources, const RowSelection &selection, qsizetype begin, qsizetype end)
+{
+    levels.resize(sources.size());
+    for(std::size_t l=0;l<sources.size();++l){
+        if(sources[l].denseSize>0){
+            levels[l].dense.assign(sources[l].denseSize,-1);
+        }
+    }
+    const int lastLevel=int(sources.size())-1;
+    selection.forEach(begin,end,[&](qsizetype row){
+        int prefix=0;
+        for(int l=0;l<=lastLevel;++l){
+            const GroupSource &source=sources[l];
+            Level &level=levels[l];
+            quint32 code;
+            if(source.codes){
+                code=source.codes[row];
+            }else{
+                const QString &cell=source.cells->at(row);
+                auto it=level.valueCodes.constFind(cell);
+                if(it==level.valueCodes.constEnd()){
+                    code=level.values.size();
+                    level.valueCodes.insert(cell,code);
+                    level.values.append(cell);
+                }else{
+                    code=it.value();
+                }
+            }
+            int id;
+            int *slot=nullptr;
+            if(!level.dense.empty()){
+                slot=&level.dense[qsizetype(prefix)*source.width+code];
+                id=*slot;
+            }else{
+                id=level.ids.value((quint64(prefix)<<32)|code,-1);
+            }
+            if(id<0){
+                id=int(level.parent.size());
+                level.parent.push_back(prefix);
+                level.code.push_back(code);
+                if(slot){
+                    *slot=id;
+                }else{
+                    level.ids.insert((quint64(prefix)<<32)|code,id);
+                }
+                if(l==lastLevel){
+                    rows.emplace_back();
+                }
+            }
+            prefix=id;
+        }
+        rows[prefix].push_back(int(row));
+    });
+    // lookup tables are not needed for the merge
+    for(Level &level:levels){
+        level.dense=std::vector<int>();
+        level.ids.clear();
+        level.valueCodes.clear();
+    }
+}
+
+RowGrouping::RowGrouping()
+{
+}
+/*!
+ * \brief group selected rows by the values of columns
+ * Blocks of rows are grouped in parallel into partial tables, which are merged in block order.
+ * As blocks are ordered by row, the merge keeps the first-occurrence order of a sequential pass.
+ * Without columns all selected rows form one group.
+ * \param data
+ * \param store
+ * \param columns key columns, outermost first
+ * \param selection rows to group
+ * \param binned optional codes per key column (e.g. bins of numbers) used instead of the column values
+ */
+void RowGrouping::compute(const QVector<QStringList> &data, ColumnStore &store, const QList<int> &columns, const RowSelection &selection,
+                          const QVector<const ColumnDictionary*> &binned)
+{
+    m_columns=columns;
+    m_levels.assign(columns.size(),Level());
+    m_rows.clear();
+    m_order.clear();
+    if(columns.isEmpty()){
+        m_rows.resize(1);
+        selection.forEach([this](qsizetype row){
+            m_rows[0].push_back(int(row));
+        });
+        m_order.push_back(0);
+        return;
+    }
+    // dictionaries are built here, worker threads only read
+    std::vector<GroupSource> sources(columns.size());
+    qsizetype prefixBound=1; // upper bound of prefix ids of previous level, -1 if unknown
+    for(int l=0;l<columns.size();++l){
+        GroupSource &source=sources[l];
+        source.cells=&data.at(columns.at(l));
+        const ColumnDictionary *dict=binned.value(l,nullptr);
+        if(!dict){
+            dict=store.dictionary(columns.at(l));
+        }
+        if(dict){
+            source.codes=dict->codes.data();
+            source.width=dict->values.size();
+            m_levels[l].values=dict->values;
+        }
+        if(dict && prefixBound>0 && prefixBound*source.width<=denseKeyLimit){
+            prefixBound*=source.width;
+            source.denseSize=prefixBound;
+        }else{
+            prefixBound=-1;
+        }
+    }
+
+    const qsizetype size=selection.size();
+    const qsizetype blockSize=qMax(minGroupBlockSize,((size/(4*maxThreads())+63)/64)*64);
+    const qsizetype blocks=(size+blockSize-1)/blockSize;
+    std::vector<PartialGrouping> parts(blocks);
+    parallelFor(blocks,1,[&](qsizetype block,qsizetype){
+        const qsizetype begin=block*blockSize;
+        parts[block].build(sources,selection,begin,qMin(size,begin+blockSize));
+    });
+
+    // merge in block order, global ids are handed out in order of first occurrence
+    const int lastLevel=columns.size()-1;
+    std::vector<QHash<quint64,int>> ids(columns.size());
+    std::vector<QHash<QString,quint32>> valueCodes(columns.size());
+    std::vector<std::vector<int>> groupOf(blocks); // global group per local group of last level
+    for(qsizetype block=0;block<blocks;++block){
+        std::vector<int> prefixMap; // local to global id of previous level
+        for(int l=0;l<=lastLevel;++l){
+            const PartialGrouping::Level &partial=parts[block].levels[l];
+            Level &level=m_levels[l];
+            std::vector<quint32> codeMap;
+            if(!sources[l].codes){
+                codeMap.resize(partial.values.size());
+                for(qsizetype c=0;c<partial.values.size();++c){
+                    const QString &value=partial.values.at(c);
+                    auto it=valueCodes[l].constFind(value);
+                    if(it==valueCodes[l].constEnd()){
+                        codeMap[c]=level.values.size();
+                        valueCodes[l].insert(value,codeMap[c]);
+                        level.values.append(value);
+                    }else{
+                        codeMap[c]=it.value();
+                    }
+                }
+            }
+            std::vector<int> map(partial.parent.size());
+            for(std::size_t i=0;i<partial.parent.size();++i){
+                const int parent= l==0 ? 0 : prefixMap[partial.parent[i]];
+                const quint32 code= codeMap.empty() ? partial.code[i] : codeMap[partial.code[i]];
+                const quint64 key=(quint64(parent)<<32)|code;
+                int id=ids[l].value(key,-1);
+                if(id<0){
+                    id=int(level.parent.size());
+                    level.parent.push_back(parent);
+                    level.code.push_back(code);
+                    ids[l].insert(key,id);
+                }
+                map[i]=id;
+            }
+            prefixMap=std::move(map);
+        }
+        groupOf[block]=std::move(prefixMap);
+    }
+
+    // concatenate rows of each group in block order, which keeps them ascending
+    const int groups=int(m_levels[lastLevel].parent.size());
+    std::vector<std::size_t> fill(groups,0);
+    std::vector<std::vector<std::size_t>> offsets(blocks);
+    for(qsizetype block=0;block<blocks;++block){
+        const std::vector<std::vector<int>> &rows=parts[block].rows;
+        offsets[block].resize(rows.size());
+        for(std::size_t i=0;i<rows.size();++i){
+            const int group=groupOf[block][i];
+            offsets[block][i]=fill[group];
+            fill[group]+=rows[i].size();
+        }
+    }
+    m_rows.resize(groups);
+    for(int g=0;g<groups;++g){
+        m_rows[g].resize(fill[g]);
+    }
+    parallelFor(blocks,1,[&](qsizetype block,qsizetype){
+        std::vector<std::vector<int>> &rows=parts[block].rows;
+        for(std::size_t i=0;i<rows.size();++i){
+            std::copy(rows[i].begin(),rows[i].end(),m_rows[groupOf[block][i]].begin()+offsets[block][i]);
+            rows[i]=std::vector<int>();
+        }
+    });
+
+    // order as nested loops: compare prefix ids from outermost level inwards
+    std::vector<int> path(std::size_t(groups)*columns.size());
+    for(int g=0;g<groups;++g){
+        int id=g;
+        for(int l=lastLevel;l>=0;--l){
+            path[std::size_t(g)*columns.size()+l]=id;
+            id=m_levels[l].parent[id];
+        }
+    }
+    const int levels=columns.size();
+    m_order.resize(groups);
+    for(int g=0;g<groups;++g){
+        m_order[g]=g;
+    }
+    std::sort(m_order.begin(),m_order.end(),[&path,levels](int a,int b){
+        return std::lexicographical_compare(path.begin()+std::size_t(a)*levels,path.begin()+std::size_t(a+1)*levels,
+                                            path.begin()+std::size_t(b)*levels,path.begin()+std::size_t(b+1)*levels);
+    });
+}
+
+int RowGrouping::groupCount() const
+{
+    return int(m_order.size());
+}
+/*!
+ * \brief values of key columns of group
+ * \param group
+ * \return value per key column, outermost first
+ */
+QStringList RowGrouping::values(int group) const
+{
+    QStringList result;
+    int id=m_order.at(group);
+    for(int l=int(m_levels.size())-1;l>=0;--l){
+        const Level &level=m_levels[l];
+        result.prepend(level.values.at(level.code[id]));
+        id=level.parent[id];
+    }
+    return result;
+}
+/*!
+ * \brief rows of group in ascending order
+ * \param group
+ * \return
+ */
+const std::vector<int> &RowGrouping::rows(int group) const
+{
+    return m_rows[m_order.at(group)];
+}
+/*!
+ * \brief hand over rows of group, afterwards the group is empty
+ * \param group
+ * \return
+ */
+std::vector<int> RowGrouping::takeRows(int group)
+{
+    return std::move(m_rows[m_order.at(group)]);
+}
@@ -0,0 +1,48 @@
+#ifndef ROWGROUPING_H
+#define ROWGROUPING_H
+
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <vector>
+
+#include "columnstore.h"
+#include "rowselection.h"
+
+/*!
+ * \brief selected rows grouped by the values of key columns
+ * One pass over the rows, the composite key is resolved level by level from value codes
+ * (dictionary codes where available). Each group holds the ascending list of its rows.
+ * Groups are ordered like nested loops over the key columns with values in order of first occurrence.
+ */
+class RowGrouping
+{
+public:
+    RowGrouping();
+
+    void compute(const QVector<QStringList> &data,ColumnStore &store,const QList<int> &columns,const RowSelection &selection,
+                 const QVector<const ColumnDictionary*> &binned=QVector<const ColumnDictionary*>());
+
+    int groupCount() const;
+    QStringList values(int group) const;
+    const std::vector<int> &rows(int group) const;
+    std::vector<int> takeRows(int group);
+
+private:
+    /*!
+     * \brief distinct key prefixes of one level
+     * Prefix ids are handed out in order of first occurrence.
+     */
+    struct Level{
+        QStringList values; // value per code
+        std::vector<int> parent; // prefix id of previous level
+        std::vector<quint32> code; // value code
+    };
+
+    QList<int> m_columns;
+    std::vector<Level> m_levels;
+    std::vector<std::vector<int>> m_rows; // per prefix id of last level
+    std::vector<int> m_order; // prefix id of last level per group
+};
+
+#endif // ROWGROUPING_H
@@ -0,0 +1,289 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "rowselection.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "filterkernels.h"
+
+static const qsizetype sparseRatio=32; // row id costs 32 bits, bitmap 1 bit per row
+
+RowSelection::RowSelection():m_size(0),m_sparse(false)
+{
+}
+/*!
+ * \brief selection for size rows
+ * \param size
+ * \param value all rows selected or none
+ */
+RowSelection::RowSelection(qsizetype size, bool value):m_size(0),m_sparse(false)
+{
+    resize(size,value);
+}
+/*!
+ * \brief sparse selection from list of row ids
+ * \param size
+ * \param rows sorted ascending, no duplicates
+ * \return
+ */
+RowSelection RowSelection::fromRows(qsizetype size, std::vector<int> rows)
+{
+    RowSelection result;
+    result.m_size=size;
+    result.m_sparse=true;
+    result.m_rows=std::move(rows);
+    return result;
+}
+
+qsizetype RowSelection::size() const
+{
+    return m_size;
+}
+/*!
+ * \brief no rows at all (not: no rows selected)
+ * \return
+ */
+bool RowSelection::isEmpty() const
+{
+    return m_size==0;
+}
+/*!
+ * \brief stored as list of row ids
+ * \return
+ */
+bool RowSelection::isSparse() const
+{
+    return m_sparse;
+}
+/*!
+ * \brief resize and set all rows to value
+ * \param size
+ * \param value
+ */
+void RowSelection::resize(qsizetype size, bool value)
+{
+    m_size=size;
+    m_sparse=false;
+    m_rows=std::vector<int>();
+    m_words.assign(wordsFor(size),value ? ~quint64(0) : quint64(0));
+    clearTail();
+}
+
+bool RowSelection::test(qsizetype row) const
+{
+    if(m_sparse){
+        return std::binary_search(m_rows.begin(),m_rows.end(),int(row));
+    }
+    return (m_words[row>>6]>>(row&63))&1;
+}
+
+void RowSelection::set(qsizetype row, bool value)
+{
+    makeDense();
+    const quint64 mask=quint64(1)<<(row&63);
+    if(value){
+        m_words[row>>6]|=mask;
+    }else{
+        m_words[row>>6]&=~mask;
+    }
+}
+
+void RowSelection::fill(bool value)
+{
+    resize(m_size,value);
+}
+/*!
+ * \brief number of selected rows
+ * \return
+ */
+qsizetype RowSelection::count() const
+{
+    if(m_sparse){
+        return static_cast<qsizetype>(m_rows.size());
+    }
+    qsizetype result=0;
+    for(quint64 word:m_words){
+        result+=qPopulationCount(word);
+    }
+    return result;
+}
+/*!
+ * \brief all rows are selected
+ * \return
+ */
+bool RowSelection::all() const
+{
+    return count()==m_size;
+}
+/*!
+ * \brief intersection, both need to have the same size
+ * The result is sparse if one of the inputs is sparse.
+ * \param other
+ * \return
+ */
+RowSelection &RowSelection::operator&=(const RowSelection &other)
+{
+    if(m_sparse){
+        auto end=std::remove_if(m_rows.begin(),m_rows.end(),[&other](int row){return !other.test(row);});
+        m_rows.erase(end,m_rows.end());
+        return *this;
+    }
+    if(other.m_sparse){
+        std::vector<int> rows;
+        rows.reserve(other.m_rows.size());
+        for(int row:other.m_rows){
+            if(test(row)) rows.push_back(row);
+        }
+        *this=fromRows(m_size,std::move(rows));
+        return *this;
+    }
+    andKernel(m_words.data(),other.m_words.data(),wordCount());
+    return *this;
+}
+/*!
+ * \brief union, both need to have the same size
+ * \param other
+ * \return
+ */
+RowSelection &RowSelection::operator|=(const RowSelection &other)
+{
+    if(m_sparse && other.m_sparse){
+        std::vector<int> rows;
+        rows.reserve(m_rows.size()+other.m_rows.size());
+        std::set_union(m_rows.begin(),m_rows.end(),other.m_rows.begin(),other.m_rows.end(),std::back_inserter(rows));
+        m_rows=std::move(rows);
+        return *this;
+    }
+    makeDense();
+    if(other.m_sparse){
+        for(int row:other.m_rows){
+            m_words[row>>6]|=quint64(1)<<(row&63);
+        }
+        return *this;
+    }
+    orKernel(m_words.data(),other.m_words.data(),wordCount());
+    return *this;
+}
+/*!
+ * \brief remove rows of other selection
+ * \param other
+ * \return
+ */
+RowSelection &RowSelection::andNot(const RowSelection &other)
+{
+    if(m_sparse){
+        auto end=std::remove_if(m_rows.begin(),m_rows.end(),[&other](int row){return other.test(row);});
+        m_rows.erase(end,m_rows.end());
+        return *this;
+    }
+    if(other.m_sparse){
+        for(int row:other.m_rows){
+            m_words[row>>6]&=~(quint64(1)<<(row&63));
+        }
+        return *this;
+    }
+    andNotKernel(m_words.data(),other.m_words.data(),wordCount());
+    return *this;
+}
+/*!
+ * \brief choose representation with smaller memory footprint
+ * Row ids when less than 1/32 of the rows are selected, bitmap otherwise.
+ */
+void RowSelection::optimize()
+{
+    const qsizetype n=count();
+    if(m_sparse){
+        if(n*sparseRatio>=m_size) makeDense();
+        return;
+    }
+    if(n*sparseRatio<m_size){
+        std::vector<int> ids;
+        ids.reserve(n);
+        forEach([&ids](qsizetype row){ids.push_back(int(row));});
+        *this=fromRows(m_size,std::move(ids));
+    }
+}
+/*!
+ * \brief convert to bitmap representation
+ */
+void RowSelection::makeDense()
+{
+    if(!m_sparse) return;
+    m_words.assign(wordsFor(m_size),0);
+    for(int row:m_rows){
+        m_words[row>>6]|=quint64(1)<<(row&63);
+    }
+    m_rows=std::vector<int>();
+    m_sparse=false;
+}
+/*!
+ * \brief bitmap words
+ * Converts sparse selection to bitmap.
+ * \return
+ */
+quint64 *RowSelection::words()
+{
+    makeDense();
+    return m_words.data();
+}
+/*!
+ * \brief bitmap words, selection must not be sparse
+ * \return
+ */
+const quint64 *RowSelection::words() const
+{
+    Q_ASSERT(!m_sparse);
+    return m_words.data();
+}
+
+qsizetype RowSelection::wordCount() const
+{
+    return wordsFor(m_size);
+}
+/*!
+ * \brief selected rows as ascending list
+ * \return
+ */
+std::vector<int> RowSelection::rows() const
+{
+    if(m_sparse) return m_rows;
+    std::vector<int> result;
+    result.reserve(count());
+    forEach([&result](qsizetype row){result.push_back(int(row));});
+    return result;
+}
+/*!
+ * \brief bytes used for storing the selection
+ * \return
+ */
+qsizetype RowSelection::memoryUsage() const
+{
+    if(m_sparse) return static_cast<qsizetype>(m_rows.capacity()*sizeof(int));
+    return static_cast<qsizetype>(m_words.capacity()*sizeof(quint64));
+}
+/*!
+ * \brief number of words needed for rows
+ * \param rows
+ * \return
+ */
+qsizetype RowSelection::wordsFor(qsizetype rows)
+{
+    return (rows+63)/64;
+}
+/*!
+ * \brief bits behind last row are kept zero, so that count() and word operations stay valid
+ */
+void RowSelection::clearTail()
+{
+    const int rest=m_size&63;
+    if(rest!=0 && !m_words.empty()){
+        m_words.back()&=(quint64(1)<<rest)-1;
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef ROWSELECTION_H
+#define ROWSELECTION_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <vector>
+#include <algorithm>
+
+/*!
+ * \brief set of rows
+ * Stored as packed bitmap (64 rows per word), combination with other selections is done word-wise.
+ * Sparse selections can be stored as sorted list of row ids instead (see optimize()).
+ */
+class RowSelection
+{
+public:
+    RowSelection();
+    explicit RowSelection(qsizetype size,bool value=false);
+    static RowSelection fromRows(qsizetype size,std::vector<int> rows);
+
+    qsizetype size() const;
+    bool isEmpty() const;
+    bool isSparse() const;
+    void resize(qsizetype size,bool value=false);
+
+    bool test(qsizetype row) const;
+    void set(qsizetype row,bool value=true);
+    void fill(bool value);
+    qsizetype count() const;
+    bool all() const;
+
+    RowSelection &operator&=(const RowSelection &other);
+    RowSelection &operator|=(const RowSelection &other);
+    RowSelection &andNot(const RowSelection &other);
+
+    void optimize();
+    void makeDense();
+
+    quint64 *words();
+    const quint64 *words() const;
+    qsizetype wordCount() const;
+    std::vector<int> rows() const;
+    qsizetype memoryUsage() const;
+
+    template <typename Fn>
+    void forEach(Fn fn) const;
+    template <typename Fn>
+    void forEach(qsizetype begin,qsizetype end,Fn fn) const;
+
+    static qsizetype wordsFor(qsizetype rows);
+
+private:
+    void clearTail();
+
+    qsizetype m_size;
+    bool m_sparse;
+    std::vector<quint64> m_words;
+    std::vector<int> m_rows; // sorted, only used when sparse
+};
+/*!
+ * \brief call fn(row) for every selected row in ascending order
+ * Bitmaps are scanned word-wise, only set bits are visited.
+ * \param fn
+ */
+template <typename Fn>
+void RowSelection::forEach(Fn fn) const
+{
+    if(m_sparse){
+        for(int row:m_rows){
+            fn(qsizetype(row));
+        }
+        return;
+    }
+    const qsizetype n=wordCount();
+    for(qsizetype w=0;w<n;++w){
+        quint64 bits=m_words[w];
+        while(bits){
+            fn(w*64+qCountTrailingZeroBits(bits));
+            bits&=bits-1;
+        }
+    }
+}
+/*!
+ * \brief call fn(row) for every selected row in [begin,end) in ascending order
+ * \param begin
+ * \param end
+ * \param fn
+ */
+template <typename Fn>
+void RowSelection::forEach(qsizetype begin, qsizetype end, Fn fn) const
+{
+    if(m_sparse){
+        auto it=std::lower_bound(m_rows.begin(),m_rows.end(),begin,[](int row,qsizetype value){
+            return row<value;
+        });
+        for(;it!=m_rows.end() && *it<end;++it){
+            fn(qsizetype(*it));
+        }
+        return;
+    }
+    for(qsizetype w=begin/64;w*64<end;++w){
+        quint64 bits=m_words[w];
+        if(w==begin/64){
+            bits&=~quint64(0)<<(begin&63);
+        }
+        if(end-w*64<64){
+            bits&=(quint64(1)<<(end-w*64))-1;
+        }
+        while(bits){
+            fn(w*64+qCountTrailingZeroBits(bits));
+            bits&=bits-1;
+        }
+    }
+}
+
+#endif // ROWSELECTION_H
@@ -0,0 +1,198 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "statistics.h"
+
+#include <cmath>
+#include <vector>
+
+#include "parallel.h"
+
+static const qsizetype statsBlockSize=1<<16;
+
+/*!
+ * \brief add value to compensated sum (Neumaier)
+ * \param sum
+ * \param compensation lost low order bits of sum
+ * \param value
+ */
+static void addCompensated(double &sum,double &compensation,double value)
+{
+    const double t=sum+value;
+    if(std::fabs(sum)>=std::fabs(value)){
+        compensation+=(sum-t)+value;
+    }else{
+        compensation+=(value-t)+sum;
+    }
+    sum=t;
+}
+
+/*!
+ * \brief add one value
+ * NaN is ignored.
+ * \param value
+ */
+void RunningStats::add(double value)
+{
+    if(std::isnan(value)) return;
+    ++count;
+    double delta=value-mean;
+    mean+=delta/count;
+    m2+=delta*(value-mean);
+    addCompensated(total,compensation,value);
+    if(value<min) min=value;
+    if(value>max) max=value;
+}
+/*!
+ * \brief combine with partial result of other values (Chan et al.)
+ * \param other
+ */
+void RunningStats::merge(const RunningStats &other)
+{
+    if(other.count==0) return;
+    if(count==0){
+        *this=other;
+        return;
+    }
+    const qint64 n=count+other.count;
+    const double delta=other.mean-mean;
+    mean+=delta*other.count/n;
+    m2+=other.m2+delta*delta*double(count)*double(other.count)/n;
+    addCompensated(total,compensation,other.total);
+    compensation+=other.compensation;
+    count=n;
+    if(other.min<min) min=other.min;
+    if(other.max>max) max=other.max;
+}
+/*!
+ * \brief remove values which have been merged before
+ * min/max can not be restored and stay unchanged.
+ * \param other
+ */
+void RunningStats::remove(const RunningStats &other)
+{
+    if(other.count==0) return;
+    if(other.count>=count){
+        *this=RunningStats();
+        return;
+    }
+    const qint64 n=count-other.count;
+    const double restMean=(mean*count-other.mean*other.count)/n;
+    const double delta=other.mean-restMean;
+    m2-=other.m2+delta*delta*double(n)*double(other.count)/count;
+    if(m2<0) m2=0;
+    addCompensated(total,compensation,-other.total);
+    compensation-=other.compensation;
+    mean=restMean;
+    count=n;
+}
+
+double RunningStats::sum() const
+{
+    return total+compensation;
+}
+/*!
+ * \brief sample variance
+ * \return
+ */
+double RunningStats::variance() const
+{
+    if(count<2) return 0;
+    return m2/(count-1);
+}
+
+double RunningStats::std() const
+{
+    return std::sqrt(variance());
+}
+/*!
+ * \brief statistics of one block
+ * Two branch free passes (sum/min/max, then squared deviation) which the compiler can vectorize.
+ * The sum of deviations corrects the rounding error of the summed values.
+ * \param values
+ * \param count
+ * \return
+ */
+static RunningStats reduceBlock(const double *values,qsizetype count)
+{
+    RunningStats result;
+    double sum=0;
+    qint64 n=0;
+    double mn=result.min;
+    double mx=result.max;
+    for(qsizetype i=0;i<count;++i){
+        const double v=values[i];
+        const bool valid= v==v; // false for NaN
+        sum+= valid ? v : 0.;
+        n+= valid;
+        mn= std::fmin(mn,v);
+        mx= std::fmax(mx,v);
+    }
+    if(n==0) return result;
+    const double mean=sum/n;
+    double m2=0;
+    double deviation=0; // sum of deviations, rounding error of the first pass
+    for(qsizetype i=0;i<count;++i){
+        const double v=values[i];
+        const double d= v==v ? v-mean : 0.;
+        m2+=d*d;
+        deviation+=d;
+    }
+    result.count=n;
+    result.mean=mean;
+    result.m2=m2;
+    result.total=sum;
+    result.compensation=std::fma(double(n),mean,-sum)+deviation; // exact sum is n*mean+deviation
+    result.min=mn;
+    result.max=mx;
+    return result;
+}
+/*!
+ * \brief statistics of values
+ * Runs in parallel blocks, NaN is ignored.
+ * \param values
+ * \param count
+ * \return
+ */
+RunningStats reduceStats(const double *values, qsizetype count)
+{
+    const qsizetype blocks=(count+statsBlockSize-1)/statsBlockSize;
+    std::vector<RunningStats> partial(blocks);
+    parallelFor(count,statsBlockSize,[&](qsizetype begin,qsizetype end){
+        partial[begin/statsBlockSize]=reduceBlock(values+begin,end-begin);
+    });
+    RunningStats result;
+    for(const RunningStats &stats:partial){
+        result.merge(stats);
+    }
+    return result;
+}
+/*!
+ * \brief statistics of values at given rows
+ * \param values
+ * \param rows
+ * \param count number of rows
+ * \return
+ */
+RunningStats reduceStats(const double *values, const int *rows, qsizetype count)
+{
+    const qsizetype blocks=(count+statsBlockSize-1)/statsBlockSize;
+    std::vector<RunningStats> partial(blocks);
+    parallelFor(count,statsBlockSize,[&](qsizetype begin,qsizetype end){
+        std::vector<double> gathered(end-begin);
+        for(qsizetype i=begin;i<end;++i){
+            gathered[i-begin]=values[rows[i]];
+        }
+        partial[begin/statsBlockSize]=reduceBlock(gathered.data(),end-begin);
+    });
+    RunningStats result;
+    for(const RunningStats &stats:partial){
+        result.merge(stats);
+    }
+    return result;
+}
@@ -0,0 +1,32 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <QtGlobal>
+#include <limits>
+
+/*!
+ * \brief count/sum/mean/variance/min/max accumulator (Welford)
+ * Partial results of blocks can be merged, so reductions can run in parallel.
+ * The sum is accumulated separately, mean times count loses precision.
+ */
+struct RunningStats{
+    qint64 count=0;
+    double mean=0;
+    double m2=0;
+    double min=std::numeric_limits<double>::infinity();
+    double max=-std::numeric_limits<double>::infinity();
+    double total=0; // sum of values, compensated (Neumaier)
+    double compensation=0;
+
+    void add(double value);
+    void merge(const RunningStats &other);
+    void remove(const RunningStats &other);
+    double sum() const;
+    double variance() const;
+    double std() const;
+};
+
+RunningStats reduceStats(const double *values,qsizetype count);
+RunningStats reduceStats(const double *values,const int *rows,qsizetype count);
+
+#endif // STATISTICS_H
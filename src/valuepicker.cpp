@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 Jan Sundermeyer
+**
+** License: GLP v3
+**
+****************************************************************************/
+
+#include "valuepicker.h"
+
+#include <QLineEdit>
+#include <QListView>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTimer>
+
+ValueListModel::ValueListModel(QObject *parent):QAbstractListModel(parent),m_checkedCount(0)
+{
+}
+/*!
+ * \brief set distinct values
+ * \param values
+ * \param counts rows per value
+ * \param allowed values which are checked
+ * \param allAllowed check all values (no filter active)
+ */
+void ValueListModel::setValues(const QStringList &values, const std::vector<qsizetype> &counts, const QSet<QString> &allowed, bool allAllowed)
+{
+    beginResetModel();
+    m_values=values;
+    m_counts=counts;
+    m_checked.assign(values.size(),1);
+    m_checkedCount=values.size();
+    if(!allAllowed){
+        for(qsizetype i=0;i<values.size();++i){
+            if(!allowed.contains(values.at(i))){
+                m_checked[i]=0;
+                --m_checkedCount;
+            }
+        }
+    }
+    m_shown.resize(values.size());
+    for(qsizetype i=0;i<values.size();++i){
+        m_shown[i]=int(i);
+    }
+    endResetModel();
+}
+/*!
+ * \brief only show values which contain text (case insensitive)
+ * \param text
+ */
+void ValueListModel::setFilterText(const QString &text)
+{
+    beginResetModel();
+    m_shown.clear();
+    for(qsizetype i=0;i<m_values.size();++i){
+        if(text.isEmpty() || m_values.at(i).contains(text,Qt::CaseInsensitive)){
+            m_shown.push_back(int(i));
+        }
+    }
+    endResetModel();
+}
+/*!
+ * \brief check/uncheck all shown values
+ * \param checked
+ */
+void ValueListModel::setVisibleChecked(bool checked)
+{
+    if(m_shown.empty()) return;
+    for(int i:m_shown){
+        if(m_checked[i]!=checked){
+            m_checked[i]=checked;
+            m_checkedCount+= checked ? 1 : -1;
+        }
+    }
+    emit dataChanged(index(0),index(int(m_shown.size())-1),{Qt::CheckStateRole});
+}
+
+QStringList ValueListModel::checkedValues() const
+{
+    QStringList result;
+    result.reserve(m_checkedCount);
+    for(qsizetype i=0;i<m_values.size();++i){
+        if(m_checked[i]){
+            result<<m_values.at(i);
+        }
+    }
+    return result;
+}
+
+bool ValueListModel::allChecked() const
+{
+    return m_checkedCount==m_values.size();
+}
+
+int ValueListModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid()) return 0;
+    return int(m_shown.size());
+}
+
+QVariant ValueListModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row()>=int(m_shown.size())) return QVariant();
+    const int i=m_shown[index.row()];
+    switch(role){
+    case Qt::DisplayRole:
+        return QString("%1  (%2)").arg(m_values.at(i)).arg(m_counts[i]);
+    case Qt::ToolTipRole:
+        return m_values.at(i);
+    case Qt::CheckStateRole:
+        return m_checked[i] ? Qt::Checked : Qt::Unchecked;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+bool ValueListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if(role!=Qt::CheckStateRole || !index.isValid()) return false;
+    const int i=m_shown[index.row()];
+    const bool checked= value.toInt()==Qt::Checked;
+    if(m_checked[i]==checked) return false;
+    m_checked[i]=checked;
+    m_checkedCount+= checked ? 1 : -1;
+    emit dataChanged(index,index,{Qt::CheckStateRole});
+    return true;
+}
+
+Qt::ItemFlags ValueListModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled|Qt::ItemIsUserCheckable;
+}
+
+ValuePicker::ValuePicker(int column, QWidget *parent):QWidget(parent),m_column(column)
+{
+    m_model=new ValueListModel(this);
+    leSearch=new QLineEdit;
+    leSearch->setPlaceholderText(tr("Search values"));
+    leSearch->setClearButtonEnabled(true);
+    m_searchTimer=new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(leSearch,&QLineEdit::textEdited,m_searchTimer,QOverload<>::of(&QTimer::start));
+    connect(m_searchTimer,&QTimer::timeout,this,&ValuePicker::applySearch);
+    lvValues=new QListView;
+    lvValues->setUniformItemSizes(true);
+    lvValues->setModel(m_model);
+    lblCount=new QLabel;
+    QPushButton *btAll=new QPushButton(tr("All"));
+    connect(btAll,&QPushButton::clicked,this,[this](){checkShown(true);});
+    QPushButton *btNone=new QPushButton(tr("None"));
+    connect(btNone,&QPushButton::clicked,this,[this](){checkShown(false);});
+    connect(m_model,&QAbstractItemModel::dataChanged,this,&ValuePicker::selectionChanged);
+
+    QHBoxLayout *hLayout=new QHBoxLayout;
+    hLayout->addWidget(lblCount,1);
+    hLayout->addWidget(btAll);
+    hLayout->addWidget(btNone);
+    QVBoxLayout *layout=new QVBoxLayout;
+    layout->setContentsMargins(4,4,4,4);
+    layout->addWidget(leSearch);
+    layout->addWidget(lvValues);
+    layout->addLayout(hLayout);
+    setLayout(layout);
+}
+/*!
+ * \brief set distinct values of column
+ * \param values
+ * \param counts
+ * \param allowed checked values
+ * \param allAllowed all values checked
+ */
+void ValuePicker::setValues(const QStringList &values, const std::vector<qsizetype> &counts, const QSet<QString> &allowed, bool allAllowed)
+{
+    m_model->setValues(values,counts,allowed,allAllowed);
+    lblCount->setText(tr("%1 values").arg(values.size()));
+}
+
+int ValuePicker::column() const
+{
+    return m_column;
+}
+
+QStringList ValuePicker::checkedValues() const
+{
+    return m_model->checkedValues();
+}
+
+bool ValuePicker::allChecked() const
+{
+    return m_model->allChecked();
+}
+
+void ValuePicker::applySearch()
+{
+    m_model->setFilterText(leSearch->text());
+}
+/*!
+ * \brief check/uncheck all values matching the search text
+ * \param checked
+ */
+void ValuePicker::checkShown(bool checked)
+{
+    m_model->setVisibleChecked(checked);
+}
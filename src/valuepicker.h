@@ -0,0 +1,77 @@
+#ifndef VALUEPICKER_H
+#define VALUEPICKER_H
+
+#include <QWidget>
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QSet>
+#include <vector>
+
+class QLineEdit;
+class QListView;
+class QLabel;
+class QTimer;
+
+/*!
+ * \brief checkable list of distinct values with their row count
+ * Only the values matching the search text are shown.
+ */
+class ValueListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit ValueListModel(QObject *parent = nullptr);
+
+    void setValues(const QStringList &values,const std::vector<qsizetype> &counts,const QSet<QString> &allowed,bool allAllowed);
+    void setFilterText(const QString &text);
+    void setVisibleChecked(bool checked);
+
+    QStringList checkedValues() const;
+    bool allChecked() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+    QStringList m_values;
+    std::vector<qsizetype> m_counts;
+    std::vector<quint8> m_checked;
+    std::vector<int> m_shown; // index into m_values of shown rows
+    qsizetype m_checkedCount;
+};
+
+/*!
+ * \brief searchable value picker for the header menu
+ * The list is virtualized, so thousands of distinct values are no problem.
+ * selectionChanged is emitted on every change of the checked values.
+ */
+class ValuePicker : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ValuePicker(int column,QWidget *parent = nullptr);
+
+    void setValues(const QStringList &values,const std::vector<qsizetype> &counts,const QSet<QString> &allowed,bool allAllowed);
+    int column() const;
+    QStringList checkedValues() const;
+    bool allChecked() const;
+
+signals:
+    void selectionChanged();
+
+protected:
+    void applySearch();
+    void checkShown(bool checked);
+
+private:
+    QLineEdit *leSearch;
+    QListView *lvValues;
+    QLabel *lblCount;
+    QTimer *m_searchTimer;
+    ValueListModel *m_model;
+    int m_column;
+};
+
+#endif // VALUEPICKER_H
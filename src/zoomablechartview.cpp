@@ -615,30 +615,42 @@ void ZoomableChartView::zoomReset()
     qreal ymin=0;
     qreal ymax=0;
     bool first=true;
+    QList<QXYSeries*> lst;
     for(QAbstractSeries *series:m_chart->series()){
         QXYSeries *ls=qobject_cast<QXYSeries *>(series);
         if(ls){
-            if(first && ls->count()>0){
-                first=false;
-                xmin=ls->at(0).x();
-                xmax=ls->at(0).x();
-                ymin=ls->at(0).y();
-                ymax=ls->at(0).y();
+            lst<<ls;
+        }
+        QAreaSeries *area=qobject_cast<QAreaSeries *>(series);
+        if(area){
+            // bands span between their boundary lines
+            lst<<area->upperSeries();
+            if(area->lowerSeries()){
+                lst<<area->lowerSeries();
             }
-            for(int i=0;i<ls->count();++i){
-                QPointF p=ls->at(i);
-                if(p.x()>xmax){
-                    xmax=p.x();
-                }
-                if(p.x()<xmin){
-                    xmin=p.x();
-                }
-                if(p.y()>ymax){
-                    ymax=p.y();
-                }
-                if(p.y()<ymin){
-                    ymin=p.y();
-                }
+        }
+    }
+    for(QXYSeries *ls:lst){
+        if(first && ls->count()>0){
+            first=false;
+            xmin=ls->at(0).x();
+            xmax=ls->at(0).x();
+            ymin=ls->at(0).y();
+            ymax=ls->at(0).y();
+        }
+        for(int i=0;i<ls->count();++i){
+            QPointF p=ls->at(i);
+            if(p.x()>xmax){
+                xmax=p.x();
+            }
+            if(p.x()<xmin){
+                xmin=p.x();
+            }
+            if(p.y()>ymax){
+                ymax=p.y();
+            }
+            if(p.y()<ymin){
+                ymin=p.y();
             }
         }
     }
@@ -694,6 +706,25 @@ void ZoomableChartView::addSeries(QXYSeries *series)
                          this, &ZoomableChartView::legendMarkerHovered);
     }
 }
+/*!
+ * \brief add area series (e.g. band) to chart and connect legend marker for hide/hover
+ * \param series
+ */
+void ZoomableChartView::addSeries(QAreaSeries *series)
+{
+    m_chart->addSeries(series);
+    m_chart->createDefaultAxes();
+    if(m_chart->series().length()>1){
+        m_chart->legend()->show();
+    }
+    const auto markers = m_chart->legend()->markers(series);
+    for (auto marker : markers) {
+        QObject::connect(marker, &QLegendMarker::clicked,
+                         this, &ZoomableChartView::legendMarkerClicked);
+        QObject::connect(marker, &QLegendMarker::hovered,
+                         this, &ZoomableChartView::legendMarkerHovered);
+    }
+}
 /*!
  * \brief remove signal/slot connect when series is removed
  * Basically unused.
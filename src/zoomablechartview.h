@@ -39,6 +39,7 @@ public:
 
     void clear(bool recreateDroppedSeries=true);
     void addSeries(QXYSeries *series);
+    void addSeries(QAreaSeries *series);
     void removeSeries(QXYSeries *series);
     void setTitle(const QString &title);
 